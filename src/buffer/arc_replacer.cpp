@@ -0,0 +1,257 @@
+/**
+ * ARC implementation
+ */
+#include <algorithm>
+
+#include "buffer/arc_replacer.h"
+#include "page/page.h"
+using namespace std;
+
+namespace cmudb {
+
+template <> int64_t GhostKey<Page *>(Page *const &value) {
+  return value->GetPageId();
+}
+
+template <> int64_t GhostKey<int>(const int &value) { return value; }
+
+template <typename T>
+ARCReplacer<T>::ARCReplacer(size_t capacity)
+    : capacity_(capacity == 0 ? 1 : capacity), target_(0), size_(0) {}
+
+template <typename T> ARCReplacer<T>::~ARCReplacer() {}
+
+/*
+ * Helper to forget the least recent key of a ghost list
+ */
+template <typename T>
+void ARCReplacer<T>::DropGhost(std::list<int64_t> &ghost) {
+  if (ghost.empty())
+    return;
+  ghosts_.erase(ghost.back());
+  ghost.pop_back();
+}
+
+/*
+ * Helper for RecordAccess/Insert, caller must hold latch_.
+ * A resident value moves to the front of T2. A new value goes to T2 when its
+ * key is still remembered by a ghost list (adapting the target on the way),
+ * otherwise to the front of T1.
+ */
+template <typename T> void ARCReplacer<T>::Access(const T &value) {
+  auto iter = entries_.find(value);
+  if (iter != entries_.end()) {
+    Entry &entry = iter->second;
+    if (entry.list == ListType::T1)
+      t1_.erase(entry.iter);
+    else
+      t2_.erase(entry.iter);
+    t2_.push_front(value);
+    entry.list = ListType::T2;
+    entry.iter = t2_.begin();
+    return;
+  }
+
+  auto ghost = ghosts_.find(GhostKey(value));
+  if (ghost != ghosts_.end()) {
+    if (ghost->second.list == ListType::B1) {
+      // T1 was evicted too early, give recency more room
+      size_t delta = max<size_t>(1, b2_.size() / b1_.size());
+      target_ = min(capacity_, target_ + delta);
+      b1_.erase(ghost->second.iter);
+    } else {
+      // T2 was evicted too early, give frequency more room
+      size_t delta = max<size_t>(1, b1_.size() / b2_.size());
+      target_ = target_ > delta ? target_ - delta : 0;
+      b2_.erase(ghost->second.iter);
+    }
+    ghosts_.erase(ghost);
+    t2_.push_front(value);
+    entries_[value] = Entry{ListType::T2, t2_.begin(), false};
+    return;
+  }
+
+  t1_.push_front(value);
+  entries_[value] = Entry{ListType::T1, t1_.begin(), false};
+  // keep the directory at most 2 * capacity_ keys, T1 + B1 at most capacity_
+  if (t1_.size() + b1_.size() > capacity_)
+    DropGhost(b1_);
+  if (t1_.size() + t2_.size() + b1_.size() + b2_.size() > 2 * capacity_)
+    DropGhost(b2_.empty() ? b1_ : b2_);
+}
+
+template <typename T> void ARCReplacer<T>::RecordAccess(const T &value) {
+  lock_guard<mutex> lck(latch_);
+  Access(value);
+}
+
+/*
+ * Mark value evictable. A value the replacer has never seen is accessed first.
+ */
+template <typename T> void ARCReplacer<T>::Insert(const T &value) {
+  lock_guard<mutex> lck(latch_);
+  auto iter = entries_.find(value);
+  if (iter == entries_.end()) {
+    Access(value);
+    iter = entries_.find(value);
+  }
+  if (!iter->second.evictable) {
+    iter->second.evictable = true;
+    ++size_;
+  }
+}
+
+/*
+ * Helper to evict the least recent evictable value of list and remember its
+ * key in ghost list, caller must hold latch_. When preferred is given, the
+ * least recent value satisfying it is taken if the list holds one.
+ */
+template <typename T>
+bool ARCReplacer<T>::EvictFrom(std::list<T> &list, ListType ghost, T &value,
+                               const std::function<bool(const T &)> *preferred) {
+  auto chosen = list.rend();
+  for (auto iter = list.rbegin(); iter != list.rend(); ++iter) {
+    if (!entries_.find(*iter)->second.evictable)
+      continue;
+    if (chosen == list.rend())
+      chosen = iter;
+    if (preferred == nullptr || (*preferred)(*iter)) {
+      chosen = iter;
+      break;
+    }
+  }
+  if (chosen == list.rend())
+    return false;
+  auto entry = entries_.find(*chosen);
+  value = *chosen;
+  list.erase(entry->second.iter);
+  entries_.erase(entry);
+  --size_;
+
+  std::list<int64_t> &ghost_list = ghost == ListType::B1 ? b1_ : b2_;
+  int64_t key = GhostKey(value);
+  auto old = ghosts_.find(key);
+  if (old != ghosts_.end()) {
+    (old->second.list == ListType::B1 ? b1_ : b2_).erase(old->second.iter);
+    ghosts_.erase(old);
+  }
+  ghost_list.push_front(key);
+  ghosts_[key] = GhostEntry{ghost, ghost_list.begin()};
+  return true;
+}
+
+/* Evict from T1 while it is larger than its target (or T2 has nothing
+ * evictable), otherwise from T2. Store the value in argument "value" and
+ * return true. If nothing is evictable, return false
+ */
+template <typename T> bool ARCReplacer<T>::Victim(T &value) {
+  lock_guard<mutex> lck(latch_);
+  if (size_ == 0)
+    return false;
+  return Replace(value, nullptr);
+}
+
+/*
+ * Same as Victim(), but inside the list chosen for eviction the least recent
+ * value satisfying preferred goes first
+ */
+template <typename T>
+bool ARCReplacer<T>::PreferredVictim(
+    T &value, const std::function<bool(const T &)> &preferred) {
+  lock_guard<mutex> lck(latch_);
+  if (size_ == 0)
+    return false;
+  return Replace(value, &preferred);
+}
+
+/*
+ * Helper for Victim/PreferredVictim, caller must hold latch_
+ */
+template <typename T>
+bool ARCReplacer<T>::Replace(T &value,
+                             const std::function<bool(const T &)> *preferred) {
+  if (t1_.size() > target_ || t2_.empty()) {
+    if (EvictFrom(t1_, ListType::B1, value, preferred))
+      return true;
+    return EvictFrom(t2_, ListType::B2, value, preferred);
+  }
+  if (EvictFrom(t2_, ListType::B2, value, preferred))
+    return true;
+  return EvictFrom(t1_, ListType::B1, value, preferred);
+}
+
+/*
+ * Pin value: it stays resident but cannot be evicted. If removal is
+ * successful, return true, otherwise return false
+ */
+template <typename T> bool ARCReplacer<T>::Erase(const T &value) {
+  lock_guard<mutex> lck(latch_);
+  auto iter = entries_.find(value);
+  if (iter == entries_.end() || !iter->second.evictable)
+    return false;
+  iter->second.evictable = false;
+  --size_;
+  return true;
+}
+
+/*
+ * Forget value without leaving a ghost, used when its page is deleted
+ */
+template <typename T> void ARCReplacer<T>::Remove(const T &value) {
+  lock_guard<mutex> lck(latch_);
+  auto iter = entries_.find(value);
+  if (iter == entries_.end())
+    return;
+  if (iter->second.evictable)
+    --size_;
+  if (iter->second.list == ListType::T1)
+    t1_.erase(iter->second.iter);
+  else
+    t2_.erase(iter->second.iter);
+  entries_.erase(iter);
+}
+
+/*
+ * The pool was resized, ghost lists shrink with it right away
+ */
+template <typename T> void ARCReplacer<T>::SetCapacity(size_t capacity) {
+  lock_guard<mutex> lck(latch_);
+  capacity_ = capacity == 0 ? 1 : capacity;
+  target_ = min(capacity_, target_);
+  while (t1_.size() + b1_.size() > capacity_ && !b1_.empty())
+    DropGhost(b1_);
+  while (t1_.size() + t2_.size() + b1_.size() + b2_.size() > 2 * capacity_ &&
+         !(b1_.empty() && b2_.empty()))
+    DropGhost(b2_.empty() ? b1_ : b2_);
+}
+
+/*
+ * Evictable values of T2, which were hit again, then those of T1, each list
+ * from the most recent one
+ */
+template <typename T>
+void ARCReplacer<T>::GetRecencyOrder(std::vector<T> &values) {
+  lock_guard<mutex> lck(latch_);
+  for (auto list : {&t2_, &t1_}) {
+    for (auto &value : *list) {
+      if (entries_[value].evictable)
+        values.push_back(value);
+    }
+  }
+}
+
+template <typename T> size_t ARCReplacer<T>::Size() {
+  lock_guard<mutex> lck(latch_);
+  return size_;
+}
+
+template <typename T> size_t ARCReplacer<T>::GetTarget() {
+  lock_guard<mutex> lck(latch_);
+  return target_;
+}
+
+template class ARCReplacer<Page *>;
+// test only
+template class ARCReplacer<int>;
+
+} // namespace cmudb
@@ -0,0 +1,25 @@
+/**
+ * buffer_access_strategy.cpp
+ */
+#include <algorithm>
+
+#include "buffer/buffer_access_strategy.h"
+#include "buffer/buffer_pool_manager.h"
+
+namespace cmudb {
+
+BufferAccessStrategy::BufferAccessStrategy(
+    BufferPoolManager *buffer_pool_manager, size_t ring_size)
+    : buffer_pool_manager_(buffer_pool_manager),
+      rings_(buffer_pool_manager->GetNumPartitions()) {
+  size_t partition_size =
+      buffer_pool_manager->GetPoolSize() / rings_.size();
+  ring_size_ = std::max<size_t>(
+      1, std::min(ring_size / rings_.size(), partition_size / 4));
+}
+
+BufferAccessStrategy::~BufferAccessStrategy() {
+  buffer_pool_manager_->ReleaseStrategy(this);
+}
+
+} // namespace cmudb
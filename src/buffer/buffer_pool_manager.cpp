@@ -1,4 +1,11 @@
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <unordered_set>
+
 #include "buffer/buffer_pool_manager.h"
+#include "common/logger.h"
+#include "common/trace.h"
 using namespace std;
 
 namespace cmudb {
@@ -6,34 +13,482 @@ namespace cmudb {
 /*
  * BufferPoolManager Constructor
  * When log_manager is nullptr, logging is disabled (for test purpose)
- * WARNING: Do Not Edit This Function
+ * num_partitions: number of independent slices the frames are split into,
+ * every slice gets its own page table, replacer, free list and latch
+ * replacer_type: replacement policy of the partitions, LRU by default
+ * replacer_k: number of remembered accesses when replacer_type is LRU_K
+ * page_table_type: hash table mapping page ids to frames, the lock-free
+ * linear probing table by default
+ * A read-only disk_manager makes the pool hand out views of its mapping,
+ * pool_size is ignored then
  */
 BufferPoolManager::BufferPoolManager(size_t pool_size,
                                                  DiskManager *disk_manager,
-                                                 LogManager *log_manager)
-    : pool_size_(pool_size), disk_manager_(disk_manager),
-      log_manager_(log_manager) {
-  // a consecutive memory space for buffer pool
-  pages_ = new Page[pool_size_];
-  page_table_ = new ExtendibleHash<page_id_t, Page *>(BUCKET_SIZE);
-  replacer_ = new LRUReplacer<Page *>;
-  free_list_ = new std::list<Page *>;
+                                                 LogManager *log_manager,
+                                                 size_t num_partitions,
+                                                 ReplacerType replacer_type,
+                                                 size_t replacer_k,
+                                                 PageTableType page_table_type)
+    : pool_size_(0), page_size_(disk_manager->GetPageSize()),
+      disk_manager_(disk_manager),
+      log_manager_(log_manager), replacer_type_(replacer_type),
+      replacer_k_(replacer_k), page_table_type_(page_table_type),
+      mapped_pages_(nullptr), num_mapped_pages_(0), prefetch_thread_(nullptr), prefetch_stop_(false), flush_thread_(nullptr),
+      flush_stop_(false), clean_target_(0), warmup_thread_(nullptr),
+      warmup_stop_(false), pinned_frames_(0),
+      pinned_frames_high_water_(0) {
+  if (disk_manager_->IsReadOnly()) {
+    num_mapped_pages_ = disk_manager_->GetNumPages();
+    mapped_pages_ = new Page[num_mapped_pages_];
+    for (page_id_t i = 0; i < num_mapped_pages_; ++i) {
+      // the mapping is read-only, writing to a page faults
+      mapped_pages_[i].data_ =
+          const_cast<char *>(disk_manager_->GetMappedPage(i));
+      mapped_pages_[i].page_size_ = page_size_;
+      mapped_pages_[i].page_id_ = i;
+    }
+    pool_size = 0;
+  }
+  // never create a partition without frames
+  if (num_partitions == 0)
+    num_partitions = 1;
+  if (num_partitions > pool_size && pool_size > 0)
+    num_partitions = pool_size;
 
-  // put all the pages into free list
-  for (size_t i = 0; i < pool_size_; ++i) {
-    free_list_->push_back(&pages_[i]);
+  for (size_t i = 0; i < num_partitions; ++i) {
+    Partition *partition = new Partition;
+    size_t capacity =
+        pool_size / num_partitions + (i < pool_size % num_partitions);
+    partition->page_table_ = CreatePageTable(capacity);
+    partition->page_table_capacity_ = capacity;
+    partition->replacer_ = CreateReplacer(capacity);
+    partition->free_list_ = new std::list<Page *>;
+    partitions_.push_back(partition);
   }
+  // the first chunk is a consecutive memory space for the whole pool
+  AddFrames(pool_size);
 }
 
 /*
  * BufferPoolManager Deconstructor
- * WARNING: Do Not Edit This Function
  */
 BufferPoolManager::~BufferPoolManager() {
-  delete[] pages_;
-  delete page_table_;
-  delete replacer_;
-  delete free_list_;
+  warmup_stop_ = true;
+  if (warmup_thread_ != nullptr) {
+    warmup_thread_->join();
+    delete warmup_thread_;
+  }
+  StopFlushThread();
+  {
+    lock_guard<mutex> lck(prefetch_latch_);
+    prefetch_stop_ = true;
+  }
+  prefetch_cv_.notify_all();
+  if (prefetch_thread_ != nullptr) {
+    prefetch_thread_->join();
+    delete prefetch_thread_;
+  }
+  if (!warmup_file_.empty())
+    SaveWarmupFile();
+  for (auto partition : partitions_) {
+    delete partition->PageTable();
+    for (auto page_table : partition->retired_page_tables_)
+      delete page_table;
+    delete partition->replacer_;
+    delete partition->free_list_;
+    delete partition;
+  }
+  for (auto &chunk : chunks_) {
+    delete[] chunk.pages_;
+    delete[] chunk.data_;
+  }
+  delete[] mapped_pages_;
+}
+
+/*
+ * Helper to build the page table of one partition according to
+ * page_table_type_
+ * capacity: number of frames, i.e. at most that many pages are mapped at once
+ */
+HashTable<page_id_t, Page *> *
+BufferPoolManager::CreatePageTable(size_t capacity) {
+  switch (page_table_type_) {
+  case PageTableType::EXTENDIBLE_HASH:
+    return new ExtendibleHash<page_id_t, Page *>(BUCKET_SIZE);
+  case PageTableType::LINEAR_PROBE:
+  default:
+    // never more pages than frames are mapped, the table does not grow
+    return new LinearProbeHashTable<page_id_t, Page *>(capacity);
+  }
+}
+
+/*
+ * Helper to replace the page table of partition once its frames outnumber
+ * the pages the table may map, caller must hold partition.latch_. The new
+ * table has room for twice the frames, so that a few more resizes fit in,
+ * and gets every page mapped by the old one. The old table stays alive until
+ * destruction because latch-free lookups may still be reading it.
+ */
+void BufferPoolManager::GrowPageTable(Partition &partition) {
+  // an extendible hash grows by itself
+  if (page_table_type_ != PageTableType::LINEAR_PROBE ||
+      partition.frames_.size() <= partition.page_table_capacity_)
+    return;
+  HashTable<page_id_t, Page *> *old_table = partition.PageTable();
+  size_t capacity = partition.frames_.size() * 2;
+  HashTable<page_id_t, Page *> *table = CreatePageTable(capacity);
+  for (auto page : partition.frames_) {
+    Page *mapped;
+    page_id_t page_id = page->page_id_;
+    if (page_id != INVALID_PAGE_ID && old_table->Find(page_id, mapped) &&
+        mapped == page)
+      table->Insert(page_id, page);
+  }
+  partition.retired_page_tables_.push_back(old_table);
+  partition.page_table_.store(table, memory_order_release);
+  partition.page_table_capacity_ = capacity;
+}
+
+/*
+ * Helper to build the replacer of one partition according to replacer_type_
+ * capacity: number of frames the replacer has to track
+ */
+Replacer<Page *> *BufferPoolManager::CreateReplacer(size_t capacity) {
+  switch (replacer_type_) {
+  case ReplacerType::CLOCK:
+    return new ClockReplacer<Page *>(capacity);
+  case ReplacerType::LRU_K:
+    return new LRUKReplacer<Page *>(replacer_k_);
+  case ReplacerType::ARC:
+    return new ARCReplacer<Page *>(capacity);
+  case ReplacerType::LRU:
+  default:
+    return new LRUReplacer<Page *>;
+  }
+}
+
+/*
+ * Helper to find a frame for a new page inside one partition, caller must
+ * hold partition.latch_.
+ * Always take a frame from the free list first, otherwise ask the replacer
+ * for a victim, clean ones preferred, write it back if it is dirty and drop
+ * it from the page table. The frame is returned claimed, the caller gives it
+ * a pin count once the new page is in place.
+ * return nullptr if all the pages in this partition are pinned
+ */
+Page *BufferPoolManager::GetVictimPage(Partition &partition) {
+  Page *res;
+  // a free frame is only pinned by a fetch that found it stale, that fetch
+  // lets go of it right away
+  for (size_t i = partition.free_list_->size(); i > 0; --i) {
+    res = partition.free_list_->front();
+    partition.free_list_->pop_front();
+    if (ClaimFrame(res))
+      return res;
+    partition.free_list_->push_back(res);
+  }
+  Page *victim = nullptr;
+  vector<Page *> written;
+  while (victim == nullptr &&
+         partition.replacer_->PreferredVictim(
+             res, [](Page *const &page) { return !page->is_dirty_; })) {
+    if (ClaimFrame(res)) {
+      EvictPage(partition, res);
+      victim = res;
+    } else if (res->pin_count_ < 0) {
+      // claimed by the flush thread during a write, it stays evictable
+      written.push_back(res);
+    }
+    // pinned by a hit between its lookup and leaving the replacer, it goes
+    // back to the replacer when unpinned
+  }
+  for (auto page : written)
+    partition.replacer_->Insert(page);
+  return victim;
+}
+
+/*
+ * Helper to pin page without any latch, fails while the frame is claimed.
+ * The frame may hold another page by now, the caller checks its page id.
+ * return true if the page was pinned
+ */
+bool BufferPoolManager::TryPin(Page *page) {
+  int pin_count = page->pin_count_;
+  while (pin_count >= 0) {
+    if (page->pin_count_.compare_exchange_weak(pin_count, pin_count + 1)) {
+      if (pin_count == 0)
+        NotePinned();
+      return true;
+    }
+  }
+  return false;
+}
+
+/*
+ * Helper to drop one pin of page, which belongs to partition. The partition
+ * latch is only taken when the pin count drops to zero, the frame then goes
+ * back to the replacer unless it was pinned again or reused meanwhile.
+ * return false if the page was not pinned
+ */
+bool BufferPoolManager::ReleasePin(Partition &partition, Page *page) {
+  int pin_count = page->pin_count_;
+  while (pin_count > 0 &&
+         !page->pin_count_.compare_exchange_weak(pin_count, pin_count - 1))
+    ;
+  if (pin_count <= 0)
+    return false;
+  if (pin_count > 1)
+    return true;
+  NoteUnpinned();
+  auto lck = LockPartition(partition);
+  // ring pages stay with their scan, free frames have no page
+  if (page->pin_count_ == 0 && page->strategy_ == nullptr &&
+      page->page_id_ != INVALID_PAGE_ID)
+    partition.replacer_->Insert(page);
+  NotifyFrameWaiter(partition);
+  return true;
+}
+
+/*
+ * Helper to take an unpinned frame away from latch-free pinning, caller must
+ * hold the latch of its partition and set the pin count again before
+ * releasing it. Nothing but TryPin() ever sees a claimed frame.
+ * return false if the frame is pinned
+ */
+bool BufferPoolManager::ClaimFrame(Page *page) {
+  int unpinned = 0;
+  return page->pin_count_.compare_exchange_strong(unpinned, -1);
+}
+
+/*
+ * Helper to decide whether the thread may look for a frame of partition,
+ * caller must hold partition.latch_. Queued threads are served in order, so a
+ * thread which is not queued yet only gets a frame when nobody is waiting.
+ */
+bool BufferPoolManager::MayTakeFrame(Partition &partition,
+                                     FrameWaiter &waiter) {
+  return partition.waiters_.empty() || partition.waiters_.front() == &waiter;
+}
+
+/*
+ * Helper to wait until waiter is first in the frame queue of partition and a
+ * frame may have become available, caller must hold partition.latch_ through
+ * lck. The thread is queued by the first call and stays queued until waiter
+ * is destroyed, so that it keeps its place while it retries.
+ * return false if the wait timed out or the queue is full
+ */
+bool BufferPoolManager::WaitForFrame(Partition &partition,
+                                     unique_lock<mutex> &lck,
+                                     FrameWaiter &waiter) {
+  if (waiter.partition_ == nullptr) {
+    if (partition.waiters_.size() >= FRAME_WAIT_QUEUE_SIZE) {
+      counters_.Add(BufferPoolCounter::FRAME_WAIT_FAILURE);
+      return false;
+    }
+    counters_.Add(BufferPoolCounter::FRAME_WAIT);
+    waiter.partition_ = &partition;
+    waiter.deadline_ = chrono::steady_clock::now() + FRAME_WAIT_TIMEOUT;
+    partition.waiters_.push_back(&waiter);
+  }
+  do {
+    if (waiter.cv_.wait_until(lck, waiter.deadline_) == cv_status::timeout) {
+      counters_.Add(BufferPoolCounter::FRAME_WAIT_FAILURE);
+      return false;
+    }
+  } while (partition.waiters_.front() != &waiter);
+  return true;
+}
+
+/*
+ * Helper to wake up the first thread waiting for a frame of partition, called
+ * with partition.latch_ held whenever a frame becomes free or evictable
+ */
+void BufferPoolManager::NotifyFrameWaiter(Partition &partition) {
+  if (!partition.waiters_.empty())
+    partition.waiters_.front()->cv_.notify_one();
+}
+
+/*
+ * Leave the frame queue, the next thread gets its turn. Must be called under
+ * the latch of the partition queued on.
+ */
+void BufferPoolManager::FrameWaiter::Leave() {
+  if (partition_ == nullptr)
+    return;
+  auto &waiters = partition_->waiters_;
+  bool first = waiters.front() == this;
+  waiters.erase(find(waiters.begin(), waiters.end(), this));
+  if (first && !waiters.empty())
+    waiters.front()->cv_.notify_one();
+  partition_ = nullptr;
+}
+
+/*
+ * Helper to look page_id up in the page table of partition, caller must hold
+ * partition.latch_ through lck. A frame still claimed by a read or write
+ * running without the latch is waited for, so the page found can be used.
+ * return false if the page is not resident
+ */
+bool BufferPoolManager::FindPage(Partition &partition, unique_lock<mutex> &lck,
+                                 page_id_t page_id, Page *&page) {
+  while (partition.PageTable()->Find(page_id, page)) {
+    // claims taken under the latch are given up before it is released
+    if (page->pin_count_ < 0) {
+      partition.io_cv_.wait(lck);
+      continue;
+    }
+    // never hand out a frame which holds another page by now
+    if (page->page_id_ == page_id)
+      return true;
+    TRACE_DEBUG("FindPage() stale entry of page %lld", page_id);
+    partition.PageTable()->Remove(page_id);
+    return false;
+  }
+  return false;
+}
+
+/*
+ * Helper to read page_id into the claimed frame page, caller must hold
+ * partition.latch_ through lck. The page is entered into the page table
+ * first, so that other fetches of it wait in FindPage() instead of reading it
+ * a second time, then the latch is released during the read. The frame is
+ * still claimed on return, with the latch held again.
+ * return false if the page failed its checksum, the frame is free then
+ */
+bool BufferPoolManager::ReadFrame(Partition &partition,
+                                  unique_lock<mutex> &lck, Page *page,
+                                  page_id_t page_id) {
+  page->page_id_ = page_id;
+  partition.PageTable()->Insert(page_id, page);
+  lck.unlock();
+  bool intact = disk_manager_->ReadPage(page_id, page->data_);
+  lck.lock();
+  if (!intact) {
+    DropFrame(partition, page);
+    return false;
+  }
+  // the waiters check again once the caller has given up the claim
+  partition.io_cv_.notify_all();
+  return true;
+}
+
+/*
+ * Helper to give up the claimed frame page after its page failed its
+ * checksum, caller must hold partition.latch_. The page leaves the page
+ * table, so a fetch waiting for it reads it again and sees the error itself,
+ * and the frame goes back to the free list, out of any ring.
+ */
+void BufferPoolManager::DropFrame(Partition &partition, Page *page) {
+  counters_.Add(BufferPoolCounter::CHECKSUM_FAILURE);
+  partition.PageTable()->Remove(page->page_id_);
+  page->page_id_ = INVALID_PAGE_ID;
+  page->prefetched_ = false;
+  page->strategy_ = nullptr;
+  partition.free_list_->push_back(page);
+  page->pin_count_ = 0;
+  partition.io_cv_.notify_all();
+  NotifyFrameWaiter(partition);
+}
+
+/*
+ * Helper to drop the page held by an unpinned frame from the pool, caller
+ * must hold partition.latch_. The page is written back if it is dirty.
+ */
+void BufferPoolManager::EvictPage(Partition &partition, Page *page) {
+  counters_.Add(BufferPoolCounter::EVICTION);
+  partition.PageTable()->Remove(page->page_id_);
+  if (page->is_dirty_) {
+    disk_manager_->WritePage(page->page_id_, page->data_);
+    page->is_dirty_ = false;
+    counters_.Add(BufferPoolCounter::EVICTION_WRITEBACK);
+    // the flush thread is falling behind
+    flush_cv_.notify_one();
+  }
+}
+
+/*
+ * Helper to find a frame for page_id read through strategy, caller must hold
+ * partition.latch_. Once the ring is full, its next frame is recycled if the
+ * scan is still its only user, otherwise a frame is taken the usual way and
+ * replaces that one in the ring.
+ * return nullptr if all the pages in this partition are pinned
+ */
+Page *BufferPoolManager::GetRingVictim(Partition &partition,
+                                       BufferAccessStrategy *strategy,
+                                       page_id_t page_id) {
+  auto &ring =
+      strategy->rings_[static_cast<size_t>(page_id) % partitions_.size()];
+  if (ring.frames_.size() == strategy->ring_size_) {
+    Page *res = ring.frames_[ring.next_];
+    if (res->strategy_ == strategy && ClaimFrame(res)) {
+      ring.next_ = (ring.next_ + 1) % ring.frames_.size();
+      EvictPage(partition, res);
+      return res;
+    }
+  }
+  Page *res = GetVictimPage(partition);
+  if (res != nullptr)
+    AddToRing(partition, strategy, page_id, res);
+  return res;
+}
+
+/*
+ * Helper to make the frame holding page_id part of the ring of strategy,
+ * caller must hold partition.latch_. Once the ring is full the frame takes
+ * the place of the next one, which is given back to the pool.
+ */
+void BufferPoolManager::AddToRing(Partition &partition,
+                                  BufferAccessStrategy *strategy,
+                                  page_id_t page_id, Page *page) {
+  auto &ring =
+      strategy->rings_[static_cast<size_t>(page_id) % partitions_.size()];
+  if (ring.frames_.size() < strategy->ring_size_) {
+    ring.frames_.push_back(page);
+  } else {
+    ReleaseRingFrame(partition, strategy, ring.frames_[ring.next_]);
+    ring.frames_[ring.next_] = page;
+    ring.next_ = (ring.next_ + 1) % ring.frames_.size();
+  }
+  page->strategy_ = strategy;
+}
+
+/*
+ * Helper to give a frame of the ring of strategy back to the pool, caller
+ * must hold partition.latch_. A clean unpinned page is dropped at once so
+ * that its frame is free again, a dirty one goes to the replacer, a pinned
+ * one when it is unpinned.
+ */
+void BufferPoolManager::ReleaseRingFrame(Partition &partition,
+                                         BufferAccessStrategy *strategy,
+                                         Page *page) {
+  // another thread fetched the page and took it out of the ring
+  if (page->strategy_ != strategy)
+    return;
+  page->strategy_ = nullptr;
+  // a pinned page goes to the replacer when it is unpinned
+  if (page->pin_count_ > 0)
+    return;
+  NotifyFrameWaiter(partition);
+  if (page->is_dirty_ || !ClaimFrame(page)) {
+    partition.replacer_->Insert(page);
+    return;
+  }
+  partition.PageTable()->Remove(page->page_id_);
+  page->page_id_ = INVALID_PAGE_ID;
+  partition.free_list_->push_back(page);
+  page->pin_count_ = 0;
+}
+
+/*
+ * Give every frame of the ring of strategy back to the pool, called when the
+ * strategy is destroyed
+ */
+void BufferPoolManager::ReleaseStrategy(BufferAccessStrategy *strategy) {
+  for (size_t i = 0; i < partitions_.size(); ++i) {
+    auto lck = LockPartition(*partitions_[i]);
+    for (auto page : strategy->rings_[i].frames_)
+      ReleaseRingFrame(*partitions_[i], strategy, page);
+  }
 }
 
 /**
@@ -46,41 +501,120 @@ BufferPoolManager::~BufferPoolManager() {
  * entry for the new page.
  * 4. Update page metadata, read page content from disk file and return page
  * pointer
+ * A plain hit is served by step 1.1 alone without the partition latch, the
+ * latch is only taken when the page has to be read, is a ring page of a scan
+ * or was loaded by read-ahead.
+ * strategy: pages missing from the pool are read into its ring of frames
  */
-Page *BufferPoolManager::FetchPage(page_id_t page_id) { 
-  lock_guard<mutex> lck(latch_);
+Page *BufferPoolManager::FetchPage(page_id_t page_id,
+                                   BufferAccessStrategy *strategy) { 
+  if (IsMapped())
+    return FetchMappedPage(page_id);
+  Partition &partition = GetPartition(page_id);
   Page *res;
-  if (page_table_->Find(page_id, res)) {
-    res->pin_count_++;
-    replacer_->Erase(res);
-    std::cout << "FetchPage: page_id=" << res->GetPageId() 
-              << " pin_count= " << res->pin_count_ << std::endl;
-    return res;
-  }
-  if (!free_list_->empty()) {
-    res = free_list_->front(); 
-    free_list_->pop_front();
-  } 
-  else if (!replacer_->Victim(res)) {
-    std::cout << "victim: all page is pined" << std::endl;
-	assert(false);
-    return nullptr; 
-  }
-  else {
-//    std::cout << "victim size  is +++++++++++++++++++++++++++++" << replacer_->Size() << std::endl;
- //   std::cout << "victim page id is +++++++++++++++++++++++++++++" << res->GetPageId() << std::endl;
-    page_table_->Remove(res->page_id_);
-    if (res->is_dirty_) 
-      disk_manager_->WritePage(res->page_id_, res->data_);
-  }  
+  if (partition.PageTable()->Find(page_id, res) && TryPin(res)) {
+    // the frame may have been reused between lookup and pin
+    if (res->page_id_ == page_id && res->strategy_ == strategy &&
+        !res->prefetched_) {
+      counters_.Add(BufferPoolCounter::HIT);
+      counters_.Add(BufferPoolCounter::FAST_HIT);
+      // ring pages are unknown to the replacer, others must leave it before
+      // a victim search drops their history
+      if (strategy == nullptr) {
+        partition.replacer_->Erase(res);
+        partition.replacer_->RecordAccess(res);
+      }
+      return res;
+    }
+    ReleasePin(partition, res);
+  }
+
+  auto lck = LockPartition(partition);
+  FrameWaiter waiter;
+  while (true) {
+    // checked again after every wait, another thread may have loaded it
+    if (FindPage(partition, lck, page_id, res)) {
+      counters_.Add(BufferPoolCounter::HIT);
+      if (res->pin_count_++ == 0)
+        NotePinned();
+      if (res->strategy_ != nullptr) {
+        // ring pages are unknown to the replacer
+        if (res->strategy_ == strategy)
+          return res;
+        // somebody else uses the page as well, it leaves the ring
+        res->strategy_ = nullptr;
+      } else if (res->prefetched_ && strategy != nullptr) {
+        // read-ahead of the scan, the page joins its ring
+        res->prefetched_ = false;
+        partition.replacer_->Remove(res);
+        AddToRing(partition, strategy, page_id, res);
+        return res;
+      }
+      if (res->prefetched_) {
+        // read-ahead is not an access, let the replacer start from scratch
+        res->prefetched_ = false;
+        partition.replacer_->Remove(res);
+      } else {
+        partition.replacer_->Erase(res);
+      }
+      partition.replacer_->RecordAccess(res);
+      return res;
+    }
+    if (MayTakeFrame(partition, waiter)) {
+      res = strategy == nullptr ? GetVictimPage(partition)
+                                : GetRingVictim(partition, strategy, page_id);
+      if (res != nullptr)
+        break;
+    }
+    // all frames are pinned, wait for one
+    if (!WaitForFrame(partition, lck, waiter))
+      return nullptr;
+  }
+  counters_.Add(BufferPoolCounter::MISS);
+  TRACE_VERBOSE("FetchPage() miss page %lld", page_id);
+  // the next queued thread may look for a frame during the read
+  waiter.Leave();
+  res->prefetched_ = false;
+  // a corrupt page is not handed out
+  if (!ReadFrame(partition, lck, res, page_id))
+    return nullptr;
+  if (strategy == nullptr)
+    partition.replacer_->RecordAccess(res);
+  // the claim on the frame ends only now that it holds the new page
   res->pin_count_ = 1;
-  res->page_id_ = page_id;
-  disk_manager_->ReadPage(page_id, res->data_);
-//  std::cout << "read page id" << std::endl;
-  page_table_->Insert(page_id, res);
+  NotePinned();
+  return res;
+}
 
-  std::cout << "FetchPage: page_id=" << res->GetPageId() 
-            << " pin_count= " << res->pin_count_ << std::endl;
+/*
+ * FetchPage() for callers that remember which frame a page was found in, e.g.
+ * a b+ tree keeping the frames of its hot pages. The frame in hint is pinned
+ * and checked without looking at the page table; when it holds another page
+ * by now the normal FetchPage() runs and hint is pointed at its result.
+ */
+Page *BufferPoolManager::FetchPageHinted(page_id_t page_id,
+                                         atomic<Page *> &hint) {
+  if (IsMapped())
+    return FetchMappedPage(page_id);
+  Page *res = hint.load(memory_order_relaxed);
+  if (res != nullptr && TryPin(res)) {
+    // frames are never freed before the pool, a stale hint is just a miss
+    if (res->page_id_ == page_id && res->strategy_ == nullptr &&
+        !res->prefetched_) {
+      counters_.Add(BufferPoolCounter::HIT);
+      counters_.Add(BufferPoolCounter::FAST_HIT);
+      counters_.Add(BufferPoolCounter::HINT_HIT);
+      Partition &partition = GetPartition(page_id);
+      partition.replacer_->Erase(res);
+      partition.replacer_->RecordAccess(res);
+      return res;
+    }
+    // hint slots are shared by pages of different partitions
+    ReleasePin(GetFramePartition(res), res);
+  }
+  res = FetchPage(page_id);
+  if (res != nullptr)
+    hint.store(res, memory_order_relaxed);
   return res;
 }
 
@@ -89,35 +623,20 @@ Page *BufferPoolManager::FetchPage(page_id_t page_id) {
  * if pin_count>0, decrement it and if it becomes zero, put it back to
  * replacer if pin_count<=0 before this call, return false. is_dirty: set the
  * dirty flag of this page
+ * Only putting the page back to the replacer takes the partition latch.
  */
 bool BufferPoolManager::UnpinPage(page_id_t page_id, bool is_dirty) {
-  lock_guard<mutex> lck(latch_);
+  if (IsMapped())
+    return UnpinMappedPage(page_id);
+  Partition &partition = GetPartition(page_id);
   Page *p;
-  if(page_table_->Find(page_id, p)) {
-    auto pin_count = p->pin_count_;
-    std::cout << "before UnpinPage : " << "page_id = " 
-	          << page_id << " id_dirty= "
-              << is_dirty << " pin_count=" << pin_count 
-			  << " p->is_dirty_=" << p->is_dirty_ << std::endl;
-    assert(pin_count > 0);
-    if (pin_count > 0) {
-      --p->pin_count_; 
-	  if (is_dirty)
-        p->is_dirty_ = is_dirty;
-
-      pin_count = p->pin_count_;
-      std::cout << "aftre UnpinPage : " << "page_id = " 
-	            << page_id << " id_dirty= "
-                << is_dirty << " pin_count=" << pin_count 
-			    << " p->is_dirty_=" << p->is_dirty_ << std::endl;
-      if (pin_count <= 0) {
-	    replacer_->Insert(p);
-	  }
-      return true;
-    }
+  // the caller holds a pin, so the page cannot leave the page table
+  if (!partition.PageTable()->Find(page_id, p))
     return false;
-  }
-  return false;
+  // before the pin is dropped, eviction must see the flag
+  if (is_dirty)
+    p->is_dirty_ = true;
+  return ReleasePin(partition, p);
 }
 
 /*
@@ -127,44 +646,168 @@ bool BufferPoolManager::UnpinPage(page_id_t page_id, bool is_dirty) {
  * NOTE: make sure page_id != INVALID_PAGE_ID
  */
 bool BufferPoolManager::FlushPage(page_id_t page_id) { 
-  lock_guard<mutex> lck(latch_);
+  if (page_id == INVALID_PAGE_ID || IsMapped()) return false; 
+  Partition &partition = GetPartition(page_id);
+  auto lck = LockPartition(partition);
   Page *p;
-  if (!page_table_->Find(page_id, p)) return false;
-  if (page_id == INVALID_PAGE_ID) return false; 
+  if (!FindPage(partition, lck, page_id, p)) return false;
   disk_manager_->WritePage(page_id, p->data_);
+  if (p->is_dirty_)
+    counters_.Add(BufferPoolCounter::FLUSH_WRITEBACK);
+  p->is_dirty_ = false;
   return true;
 }
 
+/*
+ * Write every dirty page of the pool back to disk, e.g. at shutdown or for a
+ * checkpoint. One partition latch at a time, the unpinned dirty pages are
+ * claimed like in FlushPartition() and the pinned ones get one more pin, so
+ * none of them can be evicted or deleted; pages being written by the flush
+ * thread are waited for. A pinned page may be changed by its user meanwhile,
+ * it is written from a copy taken under its read latch, so the caller must
+ * not hold the write latch of any page. The writes run with no latch held:
+ * sorted by page id, every run of adjacent pages goes out as one sequential
+ * write, the scattered pages in between are written as one asynchronous
+ * batch, with a single sync at the end. A page changed after its image was
+ * taken is dirty again afterwards.
+ * return the number of pages written
+ */
+size_t BufferPoolManager::FlushAllPages() {
+  // dirty page and the image to write, nullptr until a pinned page is copied
+  vector<pair<Page *, const char *>> dirty_pages;
+  vector<vector<Page *>> claimed(partitions_.size());
+  vector<Page *> pinned;
+  for (size_t i = 0; i < partitions_.size(); ++i) {
+    Partition &partition = *partitions_[i];
+    auto lck = LockPartition(partition);
+    for (auto page : partition.frames_) {
+      while (page->is_dirty_ && page->page_id_ != INVALID_PAGE_ID) {
+        if (ClaimFrame(page)) {
+          claimed[i].push_back(page);
+          dirty_pages.emplace_back(page, page->data_);
+        } else if (TryPin(page)) {
+          pinned.push_back(page);
+          dirty_pages.emplace_back(page, nullptr);
+        } else {
+          partition.io_cv_.wait(lck);
+          continue;
+        }
+        break;
+      }
+    }
+  }
+  // the flag is cleared only once the image is taken, so that a change made
+  // before is written and one made after marks the page dirty again
+  vector<char> copies(pinned.size() * page_size_);
+  char *copy = copies.data();
+  for (auto &dirty : dirty_pages) {
+    Page *page = dirty.first;
+    if (dirty.second != nullptr) {
+      page->is_dirty_ = false;
+      continue;
+    }
+    page->RLatch();
+    memcpy(copy, page->data_, page_size_);
+    page->is_dirty_ = false;
+    page->RUnlatch();
+    dirty.second = copy;
+    copy += page_size_;
+  }
+  sort(dirty_pages.begin(), dirty_pages.end(),
+       [](const pair<Page *, const char *> &a,
+          const pair<Page *, const char *> &b) {
+         return a.first->page_id_ < b.first->page_id_;
+       });
+
+  vector<const char *> run;
+  vector<DiskManager::PageIO> scattered;
+  vector<Page *> scattered_pages;
+  for (size_t i = 0; i < dirty_pages.size(); ++i) {
+    Page *page = dirty_pages[i].first;
+    run.push_back(dirty_pages[i].second);
+    if (i + 1 < dirty_pages.size() &&
+        dirty_pages[i + 1].first->page_id_ == page->page_id_ + 1)
+      continue;
+    if (run.size() == 1) {
+      scattered.push_back(DiskManager::PageIO{
+          page->page_id_, const_cast<char *>(dirty_pages[i].second), true,
+          nullptr});
+      scattered_pages.push_back(page);
+    } else {
+      disk_manager_->WritePages(page->page_id_ - (run.size() - 1),
+                                run.data(), run.size());
+    }
+    run.clear();
+  }
+  // each callback writes its own slot, RunPageIO() orders them before us
+  vector<char> written(scattered.size(), false);
+  for (size_t i = 0; i < scattered.size(); ++i)
+    scattered[i].done_ = [&written, i](bool ok) { written[i] = ok; };
+  disk_manager_->RunPageIO(scattered);
+  disk_manager_->Sync();
+  size_t num_written = dirty_pages.size();
+  for (size_t i = 0; i < scattered_pages.size(); ++i) {
+    // a page that failed to be written stays dirty
+    if (!written[i]) {
+      scattered_pages[i]->is_dirty_ = true;
+      --num_written;
+    }
+  }
+  for (size_t i = 0; i < partitions_.size(); ++i) {
+    if (claimed[i].empty())
+      continue;
+    auto lck = LockPartition(*partitions_[i]);
+    for (auto page : claimed[i])
+      page->pin_count_ = 0;
+    partitions_[i]->io_cv_.notify_all();
+    NotifyFrameWaiter(*partitions_[i]);
+  }
+  for (auto page : pinned)
+    ReleasePin(GetFramePartition(page), page);
+  counters_.Add(BufferPoolCounter::FLUSH_WRITEBACK, num_written);
+  return num_written;
+}
+
 /**
  * User should call this method for deleting a page. This routine will call
  * disk manager to deallocate the page. First, if page is found within page
  * table, buffer pool manager should be reponsible for removing this entry out
  * of page table, reseting page metadata and adding back to free list. Second,
- * call disk manager's DeallocatePage() method to delete from disk file. If
- * the page is found within page table, but pin_count != 0, return false
+ * call disk manager's DeallocatePage() method to delete from disk file, also
+ * when the page is not resident. If the page is found within page table, but
+ * pin_count != 0, return false
  */
 bool BufferPoolManager::DeletePage(page_id_t page_id) { 
-  lock_guard<mutex> lck(latch_);
+  if (IsMapped())
+    return false;
+  Partition &partition = GetPartition(page_id);
+  auto lck = LockPartition(partition);
   Page *p;
-  if (page_table_->Find(page_id, p)) {
-    auto pin_count = p->pin_count_;
-//	assert(pin_count == 0);
-    if (pin_count != 0) {
-	  std::cout << "DeletePage: " << "page_id= " 
-	            << page_id << " pin_count = " << pin_count << std::endl;
-	}
-
-    page_table_->Remove(page_id);
+  if (FindPage(partition, lck, page_id, p)) {
+    int pin_count = p->pin_count_;
+    // somebody still uses the page, its frame must not be recycled
+    if (!ClaimFrame(p)) {
+      TRACE_DEBUG("DeletePage() page %lld pin_count %lld", page_id,
+                  pin_count);
+      return false;
+    }
+
+    partition.PageTable()->Remove(page_id);
 	//bug: forget to erase page from lru replacer.
-	replacer_->Erase(p);
+	partition.replacer_->Remove(p);
     p->ResetMemory();
-    p->pin_count_ = 0;
+    p->page_id_ = INVALID_PAGE_ID;
     p->is_dirty_ = false;
-    free_list_->push_back(p);
-    disk_manager_->DeallocatePage(page_id);
-    return true;
+    p->prefetched_ = false;
+    p->strategy_ = nullptr;
+    p->pin_count_ = 0;
+    partition.free_list_->push_back(p);
+    NotifyFrameWaiter(partition);
   }
-  return false;
+  // pages not in the pool go back to the free list of the file as well
+  disk_manager_->DeallocatePage(page_id);
+  counters_.Add(BufferPoolCounter::DELETE_PAGE);
+  return true;
 }
 
 /**
@@ -174,31 +817,682 @@ bool BufferPoolManager::DeletePage(page_id_t page_id) {
  * from free list or lru replacer(NOTE: always choose from free list first),
  * update new page's metadata, zero out memory and add corresponding entry
  * into page table. return nullptr if all the pages in pool are pinned
+ * owner_hint keeps the pages of a table heap or index close together on disk
  */
-Page *BufferPoolManager::NewPage(page_id_t &page_id) { 
-  lock_guard<mutex> lck(latch_);
+Page *BufferPoolManager::NewPage(page_id_t &page_id, page_id_t owner_hint) {
+  // the page id decides which partition the new page belongs to
+  page_id = disk_manager_->AllocatePage(owner_hint);
+  if (page_id == INVALID_PAGE_ID)
+    return nullptr;
+  Partition &partition = GetPartition(page_id);
+  auto lck = LockPartition(partition);
+  FrameWaiter waiter;
   Page *p;
-  page_id = disk_manager_->AllocatePage(); 
-  if (!free_list_->empty()) {
-    p = free_list_->front();
-    free_list_->pop_front();
-  } else {
-//    std::cout << "victim size  is +++++++++++++++++++++++++++++" << replacer_->Size() << std::endl;
-    if (!replacer_->Victim(p)) {
-	  assert(false);
-	  return nullptr;
-	}
-//   std::cout << "victim page id is +++++++++++++++++++++++++++++" << p->GetPageId() << std::endl;
-    page_table_->Remove(p->page_id_);
-	if (p->is_dirty_) 
-      disk_manager_->WritePage(p->page_id_, p->data_);
+  while (!FindPage(partition, lck, page_id, p)) {
+    p = MayTakeFrame(partition, waiter) ? GetVictimPage(partition) : nullptr;
+    if (p != nullptr)
+      break;
+    if (!WaitForFrame(partition, lck, waiter)) {
+      // nobody else knows the page yet
+      disk_manager_->DeallocatePage(page_id);
+      page_id = INVALID_PAGE_ID;
+      return nullptr;
+    }
   }
+  // read-ahead got here first and loaded the still empty page
+  bool resident = p->page_id_ == page_id;
+  if (resident)
+    partition.replacer_->Remove(p);
   p->page_id_ = page_id;
-  p->pin_count_++;
+  p->prefetched_ = false;
   //zero out memory.
   p->ResetMemory();
   //insert to hash table.
-  page_table_->Insert(page_id, p);
+  partition.PageTable()->Insert(page_id, p);
+  partition.replacer_->RecordAccess(p);
+  // a victim frame stays claimed until it holds the new page
+  if (!resident) {
+    p->pin_count_ = 1;
+    NotePinned();
+  } else if (p->pin_count_++ == 0) {
+    NotePinned();
+  }
+  counters_.Add(BufferPoolCounter::NEW_PAGE);
   return p;
 }
+
+PageGuard BufferPoolManager::FetchPageGuard(page_id_t page_id,
+                                            BufferAccessStrategy *strategy) {
+  return PageGuard(this, FetchPage(page_id, strategy));
+}
+
+ReadPageGuard BufferPoolManager::FetchPageRead(page_id_t page_id,
+                                               BufferAccessStrategy *strategy) {
+  return ReadPageGuard(FetchPageGuard(page_id, strategy));
+}
+
+WritePageGuard BufferPoolManager::FetchPageWrite(page_id_t page_id) {
+  return WritePageGuard(FetchPageGuard(page_id));
+}
+
+PageGuard BufferPoolManager::NewPageGuard(page_id_t &page_id,
+                                          page_id_t owner_hint) {
+  return PageGuard(this, NewPage(page_id, owner_hint));
+}
+
+/*
+ * Ask the background thread to load page_id into the pool without pinning it.
+ * depth: number of pages to load, the pages after the first one are found by
+ * applying next_page to the previously loaded one
+ * Requests are dropped when more are pending than the pool can hold.
+ */
+void BufferPoolManager::PrefetchPage(page_id_t page_id, int depth,
+                                     NextPageFn next_page) {
+  if (page_id == INVALID_PAGE_ID || depth <= 0 || IsMapped())
+    return;
+  {
+    lock_guard<mutex> lck(prefetch_latch_);
+    if (prefetch_stop_ || prefetch_queue_.size() >= pool_size_)
+      return;
+    if (prefetch_thread_ == nullptr)
+      prefetch_thread_ = new thread(&BufferPoolManager::RunPrefetchThread, this);
+    prefetch_queue_.push_back(PrefetchRequest{page_id, depth, next_page});
+  }
+  prefetch_cv_.notify_one();
+}
+
+/*
+ * Body of the read-ahead thread, serves queued requests until destruction
+ */
+void BufferPoolManager::RunPrefetchThread() {
+  unique_lock<mutex> lck(prefetch_latch_);
+  while (true) {
+    prefetch_cv_.wait(
+        lck, [this] { return prefetch_stop_ || !prefetch_queue_.empty(); });
+    if (prefetch_stop_)
+      return;
+    // requests for single pages are read together, chains page by page
+    vector<page_id_t> page_ids;
+    while (!prefetch_queue_.empty() &&
+           prefetch_queue_.front().next_page_ == nullptr &&
+           page_ids.size() < ASYNC_IO_QUEUE_DEPTH) {
+      page_ids.push_back(prefetch_queue_.front().page_id_);
+      prefetch_queue_.pop_front();
+    }
+    if (!page_ids.empty()) {
+      lck.unlock();
+      ReadAheadBatch(page_ids, false);
+      lck.lock();
+      continue;
+    }
+    PrefetchRequest request = prefetch_queue_.front();
+    prefetch_queue_.pop_front();
+    lck.unlock();
+    page_id_t page_id = request.page_id_;
+    for (int depth = request.depth_;
+         depth > 0 && page_id != INVALID_PAGE_ID;) {
+      int loaded = 0;
+      page_id = LoadRun(page_id, depth, request.next_page_, loaded);
+      if (loaded == 0) {
+        page_id = LoadPage(page_id, request.next_page_);
+        loaded = 1;
+      }
+      depth -= loaded;
+    }
+    lck.lock();
+  }
+}
+
+/*
+ * Helper for read-ahead: make page_id resident and evictable unless it is
+ * already in the pool. Never waits for a frame, the page is skipped when
+ * every frame of its partition is pinned. Page ids beyond the end of the
+ * database are ignored, they may be garbage read from a page being modified.
+ * return the id of the page following page_id according to next_page, or
+ * INVALID_PAGE_ID
+ */
+page_id_t BufferPoolManager::LoadPage(page_id_t page_id, NextPageFn next_page) {
+  if (page_id < 0 || page_id >= disk_manager_->GetNumPages())
+    return INVALID_PAGE_ID;
+  Partition &partition = GetPartition(page_id);
+  auto lck = LockPartition(partition);
+  Page *res;
+  if (!FindPage(partition, lck, page_id, res)) {
+    res = GetVictimPage(partition);
+    if (res == nullptr)
+      return INVALID_PAGE_ID;
+    if (!ReadAhead(partition, lck, res, page_id))
+      return INVALID_PAGE_ID;
+  }
+  return next_page == nullptr ? INVALID_PAGE_ID : next_page(res->data_);
+}
+
+/*
+ * Helper for chained read-ahead: read up to depth consecutive pages starting
+ * at page_id with one sequential read, betting that the chain runs through
+ * them, as it does inside an extent. The run ends before the first resident
+ * page or when no frame is left. Pages read in vain are real pages all the same, they just stay in
+ * the pool unused like any other read-ahead.
+ * loaded: set to the number of pages of the chain the run covered, 0 if
+ * nothing was read and the caller should fall back to LoadPage()
+ * return the id of the page following them in the chain, or INVALID_PAGE_ID
+ */
+page_id_t BufferPoolManager::LoadRun(page_id_t page_id, int depth,
+                                     NextPageFn next_page, int &loaded) {
+  loaded = 0;
+  if (next_page == nullptr || depth < 2 || page_id < 0)
+    return page_id;
+  page_id_t end = min<page_id_t>(page_id + depth,
+                                 disk_manager_->GetNumPages());
+  vector<Page *> run;
+  vector<char *> run_data;
+  for (page_id_t id = page_id; id < end; ++id) {
+    Partition &partition = GetPartition(id);
+    auto lck = LockPartition(partition);
+    Page *res;
+    if (partition.PageTable()->Find(id, res))
+      break;
+    res = GetVictimPage(partition);
+    if (res == nullptr)
+      break;
+    // claimed and in the page table like in ReadFrame()
+    res->prefetched_ = true;
+    res->page_id_ = id;
+    partition.PageTable()->Insert(id, res);
+    run.push_back(res);
+    run_data.push_back(res->data_);
+  }
+  if (run.empty())
+    return page_id;
+  unique_ptr<bool[]> intact(new bool[run.size()]);
+  disk_manager_->ReadPages(page_id, run_data.data(), run.size(),
+                           intact.get());
+
+  // follow the chain while it stays inside the run, a corrupt page ends it
+  page_id_t next = INVALID_PAGE_ID;
+  for (size_t i = 0; i < run.size(); ++i) {
+    ++loaded;
+    if (!intact[i]) {
+      next = INVALID_PAGE_ID;
+      break;
+    }
+    next = next_page(run[i]->data_);
+    if (next != run[i]->page_id_ + 1)
+      break;
+  }
+  for (size_t i = 0; i < run.size(); ++i) {
+    Page *page = run[i];
+    Partition &partition = GetPartition(page->page_id_);
+    auto lck = LockPartition(partition);
+    if (!intact[i]) {
+      DropFrame(partition, page);
+      continue;
+    }
+    partition.replacer_->Insert(page);
+    page->pin_count_ = 0;
+    partition.io_cv_.notify_all();
+    NotifyFrameWaiter(partition);
+  }
+  return next;
+}
+
+/*
+ * Helper to read page_id into the claimed frame page without pinning it,
+ * caller must hold partition.latch_ through lck, which is released during the
+ * read. The page is evictable right away and its first fetch does not count
+ * as an access.
+ * return false if the page failed its checksum and was dropped
+ */
+bool BufferPoolManager::ReadAhead(Partition &partition,
+                                  unique_lock<mutex> &lck, Page *page,
+                                  page_id_t page_id) {
+  page->prefetched_ = true;
+  if (!ReadFrame(partition, lck, page, page_id))
+    return false;
+  partition.replacer_->Insert(page);
+  page->pin_count_ = 0;
+  NotifyFrameWaiter(partition);
+  return true;
+}
+
+/*
+ * Helper for read-ahead and warm-up: load the pages of page_ids which are not
+ * resident yet without pinning them, reading all of them as one asynchronous
+ * batch. Their frames are claimed and entered into the page table first, like
+ * in ReadFrame(), and become evictable once the whole batch is in. Never
+ * waits for a frame, a page is skipped when every frame of its partition is
+ * pinned. With free_frames_only, as for warm-up, nothing is evicted and no
+ * frame a fetch is waiting for is taken, live traffic always wins. Pages
+ * failing their checksum are dropped again.
+ * return the number of pages loaded
+ */
+size_t BufferPoolManager::ReadAheadBatch(const vector<page_id_t> &page_ids,
+                                         bool free_frames_only) {
+  vector<Page *> loading;
+  vector<DiskManager::PageIO> batch;
+  page_id_t num_pages = disk_manager_->GetNumPages();
+  for (auto page_id : page_ids) {
+    if (page_id < 0 || page_id >= num_pages)
+      continue;
+    Partition &partition = GetPartition(page_id);
+    auto lck = LockPartition(partition);
+    Page *res;
+    if (partition.PageTable()->Find(page_id, res) ||
+        (free_frames_only && (partition.free_list_->empty() ||
+                              !partition.waiters_.empty())))
+      continue;
+    res = GetVictimPage(partition);
+    if (res == nullptr)
+      continue;
+    res->prefetched_ = true;
+    res->page_id_ = page_id;
+    partition.PageTable()->Insert(page_id, res);
+    loading.push_back(res);
+    batch.push_back(DiskManager::PageIO{page_id, res->data_, false, nullptr});
+  }
+  if (batch.empty())
+    return 0;
+  // each callback writes its own slot, RunPageIO() orders them before us
+  vector<char> intact(batch.size(), false);
+  for (size_t i = 0; i < batch.size(); ++i)
+    batch[i].done_ = [&intact, i](bool ok) { intact[i] = ok; };
+  disk_manager_->RunPageIO(batch);
+  size_t loaded = 0;
+  for (size_t i = 0; i < loading.size(); ++i) {
+    Page *page = loading[i];
+    Partition &partition = GetPartition(page->page_id_);
+    auto lck = LockPartition(partition);
+    if (!intact[i]) {
+      DropFrame(partition, page);
+      continue;
+    }
+    partition.replacer_->Insert(page);
+    page->pin_count_ = 0;
+    partition.io_cv_.notify_all();
+    NotifyFrameWaiter(partition);
+    ++loaded;
+  }
+  return loaded;
+}
+
+/*
+ * Start preloading the pages listed in warmup_file, one page id per line and
+ * hottest first, as written by the previous shutdown. Only as many pages as
+ * the pool has frames are loaded. On destruction the resident pages are
+ * listed in warmup_file again. A missing file just means a cold start.
+ */
+void BufferPoolManager::StartWarmup(const std::string &warmup_file) {
+  if (IsMapped() || warmup_thread_ != nullptr)
+    return;
+  warmup_file_ = warmup_file;
+  vector<page_id_t> page_ids;
+  ifstream input(warmup_file);
+  page_id_t page_id;
+  while (page_ids.size() < pool_size_ && input >> page_id)
+    page_ids.push_back(page_id);
+  warmup_thread_ =
+      new thread(&BufferPoolManager::RunWarmupThread, this, move(page_ids));
+}
+
+/*
+ * Body of the warm-up thread. The hottest pages come first, every batch of
+ * WARMUP_BATCH_SIZE pages is read at once, in page id order.
+ */
+void BufferPoolManager::RunWarmupThread(vector<page_id_t> page_ids) {
+  for (size_t start = 0; start < page_ids.size() && !warmup_stop_;
+       start += WARMUP_BATCH_SIZE) {
+    auto begin = page_ids.begin() + start;
+    auto end = page_ids.begin() +
+               min<size_t>(start + WARMUP_BATCH_SIZE, page_ids.size());
+    sort(begin, end);
+    vector<page_id_t> batch(begin, end);
+    counters_.Add(BufferPoolCounter::WARMUP_LOAD,
+                  ReadAheadBatch(batch, true));
+  }
+}
+
+/*
+ * Helper for the destructor: list the resident pages in warmup_file_, pinned
+ * ones first, then the evictable ones in the order of the replacers taken
+ * round robin over the partitions, then the rest. Pages of scan rings are
+ * left out, they were never meant to stay.
+ */
+void BufferPoolManager::SaveWarmupFile() {
+  vector<page_id_t> page_ids;
+  vector<vector<Page *>> orders(partitions_.size());
+  for (size_t i = 0; i < partitions_.size(); ++i) {
+    Partition &partition = *partitions_[i];
+    auto lck = LockPartition(partition);
+    unordered_set<Page *> listed;
+    for (auto page : partition.frames_) {
+      if (page->pin_count_ > 0 && page->page_id_ != INVALID_PAGE_ID &&
+          page->strategy_ == nullptr) {
+        page_ids.push_back(page->page_id_);
+        listed.insert(page);
+      }
+    }
+    // a page pinned without the latch may still be known to the replacer
+    vector<Page *> order;
+    partition.replacer_->GetRecencyOrder(order);
+    for (auto page : order) {
+      if (listed.insert(page).second)
+        orders[i].push_back(page);
+    }
+    for (auto page : partition.frames_) {
+      if (page->page_id_ != INVALID_PAGE_ID && page->strategy_ == nullptr &&
+          listed.insert(page).second)
+        orders[i].push_back(page);
+    }
+  }
+  for (size_t j = 0, found = 1; found > 0; ++j) {
+    found = 0;
+    for (auto &order : orders) {
+      if (j < order.size()) {
+        page_ids.push_back(order[j]->page_id_);
+        ++found;
+      }
+    }
+  }
+
+  ofstream output(warmup_file_, ios::trunc);
+  for (auto page_id : page_ids)
+    output << page_id << '\n';
+  if (!output) {
+    LOG_DEBUG("can't write warm-up file %s", warmup_file_.c_str());
+  }
+}
+
+/*
+ * Start the flush thread, it wakes up every FLUSH_TIMEOUT (or when eviction
+ * had to write a dirty page) and writes dirty unpinned pages back until
+ * clean_target of the unpinned frames of every partition are clean
+ */
+void BufferPoolManager::RunFlushThread(double clean_target) {
+  lock_guard<mutex> lck(flush_latch_);
+  if (flush_thread_ != nullptr)
+    return;
+  clean_target_ = min(max(clean_target, 0.0), 1.0);
+  flush_stop_ = false;
+  flush_thread_ = new thread([this] {
+    unique_lock<mutex> lck(flush_latch_);
+    while (!flush_stop_) {
+      lck.unlock();
+      for (auto partition : partitions_)
+        FlushPartition(*partition);
+      lck.lock();
+      if (!flush_stop_)
+        flush_cv_.wait_for(lck, FLUSH_TIMEOUT);
+    }
+  });
+}
+
+/*
+ * Stop and join the flush thread
+ */
+void BufferPoolManager::StopFlushThread() {
+  {
+    lock_guard<mutex> lck(flush_latch_);
+    if (flush_thread_ == nullptr)
+      return;
+    flush_stop_ = true;
+  }
+  flush_cv_.notify_all();
+  flush_thread_->join();
+  delete flush_thread_;
+  flush_thread_ = nullptr;
+}
+
+/*
+ * Helper for the flush thread: pick as many dirty unpinned pages of the
+ * partition as are needed to reach clean_target_ and write them back as one
+ * asynchronous batch without holding the partition latch. The pages stay
+ * claimed during the write so that nobody can modify or evict them.
+ */
+void BufferPoolManager::FlushPartition(Partition &partition) {
+  vector<Page *> claimed;
+  vector<DiskManager::PageIO> batch;
+  {
+    auto lck = LockPartition(partition);
+    vector<Page *> dirty_pages;
+    size_t unpinned = 0;
+    for (auto page : partition.frames_) {
+      if (page->pin_count_ > 0)
+        continue;
+      ++unpinned;
+      if (page->is_dirty_)
+        dirty_pages.push_back(page);
+    }
+    size_t clean = unpinned - dirty_pages.size();
+    size_t target = static_cast<size_t>(clean_target_ * unpinned + 0.5);
+    dirty_pages.resize(clean >= target ? 0 : target - clean);
+    for (auto page : dirty_pages) {
+      if (!ClaimFrame(page))
+        continue;
+      claimed.push_back(page);
+      batch.push_back(
+          DiskManager::PageIO{page->page_id_, page->data_, true, nullptr});
+    }
+  }
+  if (batch.empty())
+    return;
+  // each callback writes its own slot, RunPageIO() orders them before us
+  vector<char> written(batch.size(), false);
+  for (size_t i = 0; i < batch.size(); ++i)
+    batch[i].done_ = [&written, i](bool ok) { written[i] = ok; };
+  disk_manager_->RunPageIO(batch);
+
+  auto lck = LockPartition(partition);
+  for (size_t i = 0; i < claimed.size(); ++i) {
+    // a page that failed to be written stays dirty
+    if (written[i]) {
+      claimed[i]->is_dirty_ = false;
+      counters_.Add(BufferPoolCounter::BACKGROUND_WRITEBACK);
+    }
+    claimed[i]->pin_count_ = 0;
+  }
+  partition.io_cv_.notify_all();
+  NotifyFrameWaiter(partition);
+}
+
+/*
+ * Grow or shrink the pool to pool_size frames while it is in use. Only
+ * unpinned frames can be taken away, so the pool may stay larger than asked
+ * for, and every partition keeps at least one frame.
+ * return the new number of frames
+ */
+size_t BufferPoolManager::Resize(size_t pool_size) {
+  lock_guard<mutex> lck(resize_latch_);
+  if (IsMapped())
+    return pool_size_;
+  if (pool_size > pool_size_)
+    AddFrames(pool_size - pool_size_);
+  else if (pool_size < pool_size_)
+    RetireFrames(pool_size_ - pool_size);
+  return pool_size_;
+}
+
+/*
+ * Helper to allocate a chunk of count frames and spread it over the
+ * partitions, the new frames go into their free lists. Caller must hold
+ * resize_latch_ unless the pool is being constructed.
+ */
+void BufferPoolManager::AddFrames(size_t count) {
+  if (count == 0)
+    return;
+  FrameChunk chunk{new Page[count], new char[count * page_size_](), count,
+                   count, vector<Partition *>(count)};
+  for (size_t i = 0; i < count; ++i) {
+    chunk.pages_[i].data_ = chunk.data_ + i * page_size_;
+    chunk.pages_[i].page_size_ = page_size_;
+  }
+
+  size_t offset = 0;
+  for (size_t i = 0; i < partitions_.size(); ++i) {
+    Partition &partition = *partitions_[i];
+    // spread the remainder over the first partitions
+    size_t share =
+        count / partitions_.size() + (i < count % partitions_.size());
+    auto lck = LockPartition(partition);
+    for (size_t j = offset; j < offset + share; ++j) {
+      chunk.owner_[j] = &partition;
+      chunk.pages_[j].partition_ = i;
+      partition.frames_.push_back(&chunk.pages_[j]);
+      partition.free_list_->push_back(&chunk.pages_[j]);
+    }
+    GrowPageTable(partition);
+    partition.replacer_->SetCapacity(partition.frames_.size());
+    NotifyFrameWaiter(partition);
+    offset += share;
+  }
+  chunks_.push_back(std::move(chunk));
+  pool_size_ += count;
+}
+
+/*
+ * Helper to take up to count frames out of the pool, newest chunks first.
+ * Every frame is retired under the latch of its own partition only, so
+ * fetches go on meanwhile. Caller must hold resize_latch_.
+ * return number of frames retired
+ */
+size_t BufferPoolManager::RetireFrames(size_t count) {
+  size_t retired = 0;
+  for (auto chunk = chunks_.rbegin(); chunk != chunks_.rend(); ++chunk) {
+    for (size_t i = chunk->size_; i-- > 0 && retired < count;) {
+      Partition *partition = chunk->owner_[i];
+      if (partition == nullptr)
+        continue;
+      auto lck = LockPartition(*partition);
+      if (!RetireFrame(*partition, &chunk->pages_[i]))
+        continue;
+      chunk->owner_[i] = nullptr;
+      ++retired;
+      --chunk->live_;
+    }
+    if (chunk->live_ == 0 && chunk->data_ != nullptr) {
+      for (size_t i = 0; i < chunk->size_; ++i)
+        chunk->pages_[i].data_ = nullptr;
+      delete[] chunk->data_;
+      chunk->data_ = nullptr;
+    }
+    if (retired == count)
+      break;
+  }
+  pool_size_ -= retired;
+  return retired;
+}
+
+/*
+ * Helper to take one frame out of partition, caller must hold
+ * partition.latch_. The page held by the frame is evicted, a pinned frame and
+ * the last frame of a partition are kept.
+ * return true if the frame was retired
+ */
+bool BufferPoolManager::RetireFrame(Partition &partition, Page *page) {
+  if (partition.frames_.size() <= 1 || !ClaimFrame(page))
+    return false;
+  auto free_iter =
+      find(partition.free_list_->begin(), partition.free_list_->end(), page);
+  if (free_iter != partition.free_list_->end()) {
+    partition.free_list_->erase(free_iter);
+  } else {
+    // the page waits in the replacer or in the ring of a scan
+    partition.replacer_->Remove(page);
+    EvictPage(partition, page);
+  }
+  page->page_id_ = INVALID_PAGE_ID;
+  page->prefetched_ = false;
+  page->strategy_ = nullptr;
+  page->pin_count_ = 0;
+  partition.frames_.erase(
+      find(partition.frames_.begin(), partition.frames_.end(), page));
+  partition.replacer_->SetCapacity(partition.frames_.size());
+  return true;
+}
+
+/*
+ * Helper for FetchPage() on a read-only database: pin the view of page_id
+ * return nullptr if the file has no such page
+ */
+Page *BufferPoolManager::FetchMappedPage(page_id_t page_id) {
+  if (page_id < 0 || page_id >= num_mapped_pages_)
+    return nullptr;
+  Page *res = &mapped_pages_[page_id];
+  if (res->pin_count_++ == 0)
+    NotePinned();
+  counters_.Add(BufferPoolCounter::HIT);
+  return res;
+}
+
+/*
+ * Helper for UnpinPage() on a read-only database, there is nothing to write
+ * back and nothing to evict
+ */
+bool BufferPoolManager::UnpinMappedPage(page_id_t page_id) {
+  if (page_id < 0 || page_id >= num_mapped_pages_)
+    return false;
+  Page *page = &mapped_pages_[page_id];
+  int pin_count = page->pin_count_;
+  while (pin_count > 0 &&
+         !page->pin_count_.compare_exchange_weak(pin_count, pin_count - 1))
+    ;
+  if (pin_count == 1)
+    NoteUnpinned();
+  return pin_count > 0;
+}
+
+/*
+ * Number of dirty frames in the pool, pinned or not
+ */
+size_t BufferPoolManager::GetDirtyPageCount() {
+  size_t count = 0;
+  for (auto partition : partitions_) {
+    auto lck = LockPartition(*partition);
+    for (auto page : partition->frames_)
+      count += page->is_dirty_;
+  }
+  return count;
+}
+
+/*
+ * Snapshot of the counters and gauges of the pool
+ */
+BufferPoolStats BufferPoolManager::GetStats() {
+  BufferPoolStats stats;
+  counters_.Collect(stats);
+  stats.pool_size_ = pool_size_;
+  stats.pinned_frames_ = pinned_frames_;
+  stats.pinned_frames_high_water_ = pinned_frames_high_water_;
+  return stats;
+}
+
+/*
+ * Helper to latch a partition, waiting for the latch is counted and timed
+ */
+unique_lock<mutex> BufferPoolManager::LockPartition(Partition &partition) {
+  unique_lock<mutex> lck(partition.latch_, try_to_lock);
+  if (!lck.owns_lock()) {
+    auto start = chrono::steady_clock::now();
+    lck.lock();
+    counters_.Add(BufferPoolCounter::LATCH_WAIT);
+    counters_.Add(BufferPoolCounter::LATCH_WAIT_NS,
+                  chrono::duration_cast<chrono::nanoseconds>(
+                      chrono::steady_clock::now() - start)
+                      .count());
+  }
+  return lck;
+}
+
+/*
+ * Helpers to track the number of pinned frames, called when the pin count of
+ * a frame leaves / drops to zero
+ */
+void BufferPoolManager::NotePinned() {
+  size_t pinned = ++pinned_frames_;
+  size_t high_water = pinned_frames_high_water_.load(memory_order_relaxed);
+  while (pinned > high_water &&
+         !pinned_frames_high_water_.compare_exchange_weak(high_water, pinned))
+    ;
+}
+
+void BufferPoolManager::NoteUnpinned() { --pinned_frames_; }
 } // namespace cmudb
@@ -0,0 +1,63 @@
+/**
+ * buffer_pool_stats.cpp
+ */
+#include <sstream>
+
+#include "buffer/buffer_pool_stats.h"
+
+namespace cmudb {
+
+BufferPoolCounters::BufferPoolCounters() {
+  for (auto &stripe : stripes_) {
+    for (auto &value : stripe.values_)
+      value.store(0, std::memory_order_relaxed);
+  }
+}
+
+uint64_t BufferPoolCounters::Get(BufferPoolCounter counter) const {
+  uint64_t sum = 0;
+  for (auto &stripe : stripes_)
+    sum += stripe.values_[static_cast<size_t>(counter)].load(
+        std::memory_order_relaxed);
+  return sum;
+}
+
+void BufferPoolCounters::Collect(BufferPoolStats &stats) const {
+  stats.hits_ = Get(BufferPoolCounter::HIT);
+  stats.fast_hits_ = Get(BufferPoolCounter::FAST_HIT);
+  stats.hint_hits_ = Get(BufferPoolCounter::HINT_HIT);
+  stats.misses_ = Get(BufferPoolCounter::MISS);
+  stats.evictions_ = Get(BufferPoolCounter::EVICTION);
+  stats.eviction_writebacks_ = Get(BufferPoolCounter::EVICTION_WRITEBACK);
+  stats.background_writebacks_ = Get(BufferPoolCounter::BACKGROUND_WRITEBACK);
+  stats.flush_writebacks_ = Get(BufferPoolCounter::FLUSH_WRITEBACK);
+  stats.new_pages_ = Get(BufferPoolCounter::NEW_PAGE);
+  stats.deleted_pages_ = Get(BufferPoolCounter::DELETE_PAGE);
+  stats.latch_waits_ = Get(BufferPoolCounter::LATCH_WAIT);
+  stats.latch_wait_ns_ = Get(BufferPoolCounter::LATCH_WAIT_NS);
+  stats.frame_waits_ = Get(BufferPoolCounter::FRAME_WAIT);
+  stats.frame_wait_failures_ = Get(BufferPoolCounter::FRAME_WAIT_FAILURE);
+  stats.warmup_loads_ = Get(BufferPoolCounter::WARMUP_LOAD);
+  stats.checksum_failures_ = Get(BufferPoolCounter::CHECKSUM_FAILURE);
+}
+
+std::string BufferPoolStats::ToString() const {
+  std::ostringstream os;
+  os << "hits=" << hits_ << " fast_hits=" << fast_hits_
+     << " hint_hits=" << hint_hits_ << " misses=" << misses_
+     << " hit_ratio=" << GetHitRatio() << " evictions=" << evictions_
+     << " eviction_writebacks=" << eviction_writebacks_
+     << " background_writebacks=" << background_writebacks_
+     << " flush_writebacks=" << flush_writebacks_
+     << " new_pages=" << new_pages_ << " deleted_pages=" << deleted_pages_
+     << " latch_waits=" << latch_waits_
+     << " latch_wait_ns=" << latch_wait_ns_ << " frame_waits=" << frame_waits_
+     << " frame_wait_failures=" << frame_wait_failures_
+     << " warmup_loads=" << warmup_loads_
+     << " checksum_failures=" << checksum_failures_
+     << " pinned=" << pinned_frames_
+     << "/" << pool_size_ << " pinned_high_water=" << pinned_frames_high_water_;
+  return os.str();
+}
+
+} // namespace cmudb
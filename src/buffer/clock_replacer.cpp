@@ -0,0 +1,140 @@
+/**
+ * CLOCK implementation
+ */
+#include "buffer/clock_replacer.h"
+#include "page/page.h"
+using namespace std;
+
+namespace cmudb {
+
+template <typename T>
+ClockReplacer<T>::ClockReplacer(size_t capacity)
+    : slots_(capacity == 0 ? 1 : capacity), hand_(0), next_unused_(0),
+      size_(0) {
+  slot_of_.reserve(slots_.size());
+}
+
+template <typename T> ClockReplacer<T>::~ClockReplacer() {}
+
+/*
+ * Find a slot for a value seen for the first time. Untouched slots are used
+ * first, then a slot whose value is not evictable any more is recycled. The
+ * array only grows when every slot holds an evictable value.
+ */
+template <typename T> size_t ClockReplacer<T>::AcquireSlot() {
+  if (next_unused_ < slots_.size())
+    return next_unused_++;
+  for (size_t i = 0; i < slots_.size(); ++i) {
+    if (!slots_[i].evictable) {
+      slot_of_.erase(slots_[i].value);
+      return i;
+    }
+  }
+  slots_.emplace_back();
+  next_unused_ = slots_.size();
+  return slots_.size() - 1;
+}
+
+/*
+ * Insert value into CLOCK, mark it evictable and give it a second chance.
+ * Inserting a value which is already inside only refreshes its reference bit.
+ */
+template <typename T> void ClockReplacer<T>::Insert(const T &value) {
+  lock_guard<mutex> lck(latch_);
+  size_t slot;
+  auto iter = slot_of_.find(value);
+  if (iter != slot_of_.end()) {
+    slot = iter->second;
+  } else {
+    slot = AcquireSlot();
+    slots_[slot].value = value;
+    slots_[slot].evictable = false;
+    slot_of_[value] = slot;
+  }
+  if (!slots_[slot].evictable) {
+    slots_[slot].evictable = true;
+    ++size_;
+  }
+  slots_[slot].reference = true;
+}
+
+/*
+ * Helper to sweep the hand until an evictable slot without reference bit is
+ * found, caller must hold latch_. When preferred is given, reference bits
+ * are left alone, slots not satisfying it are passed over and the sweep gives
+ * up after max_steps slots.
+ */
+template <typename T>
+bool ClockReplacer<T>::Sweep(T &value,
+                             const std::function<bool(const T &)> *preferred,
+                             size_t max_steps) {
+  for (size_t step = 0; preferred == nullptr || step < max_steps; ++step) {
+    Slot &slot = slots_[hand_];
+    hand_ = (hand_ + 1) % slots_.size();
+    if (!slot.evictable || (preferred != nullptr && !(*preferred)(slot.value)))
+      continue;
+    if (slot.reference) {
+      if (preferred == nullptr)
+        slot.reference = false;
+      continue;
+    }
+    slot.evictable = false;
+    --size_;
+    value = slot.value;
+    return true;
+  }
+  return false;
+}
+
+/* If CLOCK is non-empty, sweep the hand until an evictable slot without
+ * reference bit is found, store it in argument "value" and return true. If
+ * CLOCK is empty, return false
+ */
+template <typename T> bool ClockReplacer<T>::Victim(T &value) {
+  lock_guard<mutex> lck(latch_);
+  if (size_ == 0)
+    return false;
+  // at most two rounds: the first one may only clear reference bits
+  return Sweep(value, nullptr, 0);
+}
+
+/*
+ * Same as Victim(), but one round looks for a slot satisfying preferred whose
+ * second chance is used up already before the regular sweep
+ */
+template <typename T>
+bool ClockReplacer<T>::PreferredVictim(
+    T &value, const std::function<bool(const T &)> &preferred) {
+  lock_guard<mutex> lck(latch_);
+  if (size_ == 0)
+    return false;
+  if (Sweep(value, &preferred, slots_.size()))
+    return true;
+  return Sweep(value, nullptr, 0);
+}
+
+/*
+ * Remove value from CLOCK. If removal is successful, return true, otherwise
+ * return false. The slot stays bound to value for its next Insert.
+ */
+template <typename T> bool ClockReplacer<T>::Erase(const T &value) {
+  lock_guard<mutex> lck(latch_);
+  auto iter = slot_of_.find(value);
+  if (iter == slot_of_.end() || !slots_[iter->second].evictable)
+    return false;
+  slots_[iter->second].evictable = false;
+  slots_[iter->second].reference = false;
+  --size_;
+  return true;
+}
+
+template <typename T> size_t ClockReplacer<T>::Size() {
+  lock_guard<mutex> lck(latch_);
+  return size_;
+}
+
+template class ClockReplacer<Page *>;
+// test only
+template class ClockReplacer<int>;
+
+} // namespace cmudb
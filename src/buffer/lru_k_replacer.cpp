@@ -0,0 +1,179 @@
+/**
+ * LRU-K implementation
+ */
+#include <algorithm>
+
+#include "buffer/lru_k_replacer.h"
+#include "page/page.h"
+using namespace std;
+
+namespace cmudb {
+
+template <typename T>
+LRUKReplacer<T>::LRUKReplacer(size_t k)
+    : k_(k == 0 ? 1 : k), current_timestamp_(0), size_(0) {}
+
+template <typename T> LRUKReplacer<T>::~LRUKReplacer() {}
+
+/*
+ * Helper to push the current timestamp into the history of an entry
+ */
+template <typename T> void LRUKReplacer<T>::Access(Entry &entry) {
+  if (entry.history.empty())
+    entry.history.resize(k_);
+  entry.history[entry.count % k_] = current_timestamp_++;
+  entry.count++;
+}
+
+template <typename T>
+uint64_t LRUKReplacer<T>::EarliestAccess(const Entry &entry) const {
+  if (entry.count < k_)
+    return entry.history[0];
+  // the oldest slot of the ring is the one written next
+  return entry.history[entry.count % k_];
+}
+
+/*
+ * Record an access of value at the current timestamp
+ */
+template <typename T> void LRUKReplacer<T>::RecordAccess(const T &value) {
+  lock_guard<mutex> lck(latch_);
+  Access(entries_[value]);
+}
+
+/*
+ * Mark value as evictable. A value without history counts as accessed now.
+ */
+template <typename T> void LRUKReplacer<T>::Insert(const T &value) {
+  lock_guard<mutex> lck(latch_);
+  Entry &entry = entries_[value];
+  if (entry.count == 0)
+    Access(entry);
+  if (!entry.evictable) {
+    entry.evictable = true;
+    ++size_;
+  }
+}
+
+/* Pick the evictable value with the largest backward K-distance, store it in
+ * argument "value", forget its history and return true. Values with fewer
+ * than K accesses win over all others. If nothing is evictable, return false
+ */
+template <typename T> bool LRUKReplacer<T>::Victim(T &value) {
+  lock_guard<mutex> lck(latch_);
+  if (size_ == 0)
+    return false;
+  auto victim = FindVictim(nullptr, false);
+  value = victim->first;
+  entries_.erase(victim);
+  --size_;
+  return true;
+}
+
+/*
+ * Same as Victim(), but the value satisfying preferred with the largest
+ * backward K-distance wins, as long as it is just as infinite as the regular
+ * victim: preferring must not let a hot value go before a scanned one
+ */
+template <typename T>
+bool LRUKReplacer<T>::PreferredVictim(
+    T &value, const std::function<bool(const T &)> &preferred) {
+  lock_guard<mutex> lck(latch_);
+  if (size_ == 0)
+    return false;
+  auto victim = FindVictim(nullptr, false);
+  auto preferred_victim =
+      FindVictim(&preferred, victim->second.count < k_);
+  if (preferred_victim != entries_.end())
+    victim = preferred_victim;
+  value = victim->first;
+  entries_.erase(victim);
+  --size_;
+  return true;
+}
+
+/*
+ * Helper for Victim/PreferredVictim, caller must hold latch_. Return the
+ * evictable value with the largest backward K-distance among those satisfying
+ * preferred (when given) and having fewer than K accesses (when
+ * infinite_only), or entries_.end()
+ */
+template <typename T>
+typename std::unordered_map<T, typename LRUKReplacer<T>::Entry>::iterator
+LRUKReplacer<T>::FindVictim(
+    const std::function<bool(const T &)> *preferred, bool infinite_only) {
+  auto victim = entries_.end();
+  bool victim_infinite = false;
+  uint64_t victim_timestamp = 0;
+  for (auto iter = entries_.begin(); iter != entries_.end(); ++iter) {
+    bool infinite = iter->second.count < k_;
+    if (!iter->second.evictable || (infinite_only && !infinite) ||
+        (preferred != nullptr && !(*preferred)(iter->first)))
+      continue;
+    uint64_t timestamp = EarliestAccess(iter->second);
+    if (victim == entries_.end() || (infinite && !victim_infinite) ||
+        (infinite == victim_infinite && timestamp < victim_timestamp)) {
+      victim = iter;
+      victim_infinite = infinite;
+      victim_timestamp = timestamp;
+    }
+  }
+  return victim;
+}
+
+/*
+ * Remove value from the evictable set but keep its history. If removal is
+ * successful, return true, otherwise return false
+ */
+template <typename T> bool LRUKReplacer<T>::Erase(const T &value) {
+  lock_guard<mutex> lck(latch_);
+  auto iter = entries_.find(value);
+  if (iter == entries_.end() || !iter->second.evictable)
+    return false;
+  iter->second.evictable = false;
+  --size_;
+  return true;
+}
+
+/*
+ * Forget value completely, used when its page is deleted
+ */
+template <typename T> void LRUKReplacer<T>::Remove(const T &value) {
+  lock_guard<mutex> lck(latch_);
+  auto iter = entries_.find(value);
+  if (iter == entries_.end())
+    return;
+  if (iter->second.evictable)
+    --size_;
+  entries_.erase(iter);
+}
+
+template <typename T> size_t LRUKReplacer<T>::Size() {
+  lock_guard<mutex> lck(latch_);
+  return size_;
+}
+
+/*
+ * Evictable values in reverse eviction order: values with K accesses before
+ * the others, each group by descending backward K-distance timestamp
+ */
+template <typename T>
+void LRUKReplacer<T>::GetRecencyOrder(std::vector<T> &values) {
+  lock_guard<mutex> lck(latch_);
+  std::vector<std::pair<std::pair<bool, uint64_t>, T>> order;
+  for (auto &entry : entries_) {
+    if (entry.second.evictable)
+      order.push_back({{entry.second.count >= k_,
+                        EarliestAccess(entry.second)},
+                       entry.first});
+  }
+  sort(order.rbegin(), order.rend());
+  for (auto &item : order)
+    values.push_back(item.second);
+}
+
+template class LRUKReplacer<Page *>;
+// test only
+template class LRUKReplacer<int>;
+
+} // namespace cmudb
@@ -58,6 +58,30 @@ template <typename T> bool LRUReplacer<T>::Victim(T &value) {
   return true;
 }
 
+/*
+ * Pick the least recently used value satisfying preferred among the least
+ * recently used half, or the least recently used one if there is none
+ */
+template <typename T>
+bool LRUReplacer<T>::PreferredVictim(
+    T &value, const std::function<bool(const T &)> &preferred) {
+  lock_guard<mutex> lck(latch_);
+  if (map_.empty()) return false;
+  auto victim = tail_->prev;
+  auto cur_ptr = tail_->prev;
+  for (size_t i = 0; i < (map_.size() + 1) / 2; ++i, cur_ptr = cur_ptr->prev) {
+    if (preferred(cur_ptr->value)) {
+      victim = cur_ptr;
+      break;
+    }
+  }
+  victim->prev->next = victim->next;
+  victim->next->prev = victim->prev;
+  value = victim->value;
+  map_.erase(victim->value);
+  return true;
+}
+
 /*
  * Remove value from LRU. If removal is successful, return true, otherwise
  * return false
@@ -79,6 +103,16 @@ template <typename T> size_t LRUReplacer<T>::Size() {
   return map_.size();
 }
 
+/*
+ * Values from the most to the least recently inserted
+ */
+template <typename T>
+void LRUReplacer<T>::GetRecencyOrder(std::vector<T> &values) {
+  lock_guard<mutex> lck(latch_);
+  for (auto node = head_->next; node != tail_; node = node->next)
+    values.push_back(node->value);
+}
+
 template class LRUReplacer<Page *>;
 // test only
 template class LRUReplacer<int>;
@@ -0,0 +1,81 @@
+/**
+ * page_guard.cpp
+ */
+#include <utility>
+
+#include "buffer/buffer_pool_manager.h"
+#include "buffer/page_guard.h"
+
+namespace cmudb {
+
+PageGuard::PageGuard(BufferPoolManager *buffer_pool_manager, Page *page)
+    : buffer_pool_manager_(buffer_pool_manager), page_(page) {}
+
+PageGuard::PageGuard(PageGuard &&that) noexcept
+    : buffer_pool_manager_(that.buffer_pool_manager_), page_(that.page_),
+      is_dirty_(that.is_dirty_) {
+  that.page_ = nullptr;
+  that.is_dirty_ = false;
+}
+
+PageGuard &PageGuard::operator=(PageGuard &&that) noexcept {
+  if (this != &that) {
+    Drop();
+    buffer_pool_manager_ = that.buffer_pool_manager_;
+    page_ = that.page_;
+    is_dirty_ = that.is_dirty_;
+    that.page_ = nullptr;
+    that.is_dirty_ = false;
+  }
+  return *this;
+}
+
+void PageGuard::Drop() {
+  if (page_ == nullptr)
+    return;
+  buffer_pool_manager_->UnpinPage(page_->GetPageId(), is_dirty_);
+  page_ = nullptr;
+  is_dirty_ = false;
+}
+
+ReadPageGuard::ReadPageGuard(PageGuard &&guard) : guard_(std::move(guard)) {
+  if (guard_.IsValid())
+    guard_.GetPage()->RLatch();
+}
+
+ReadPageGuard &ReadPageGuard::operator=(ReadPageGuard &&that) noexcept {
+  if (this != &that) {
+    Drop();
+    guard_ = std::move(that.guard_);
+  }
+  return *this;
+}
+
+void ReadPageGuard::Drop() {
+  if (!guard_.IsValid())
+    return;
+  guard_.GetPage()->RUnlatch();
+  guard_.Drop();
+}
+
+WritePageGuard::WritePageGuard(PageGuard &&guard) : guard_(std::move(guard)) {
+  if (guard_.IsValid())
+    guard_.GetPage()->WLatch();
+}
+
+WritePageGuard &WritePageGuard::operator=(WritePageGuard &&that) noexcept {
+  if (this != &that) {
+    Drop();
+    guard_ = std::move(that.guard_);
+  }
+  return *this;
+}
+
+void WritePageGuard::Drop() {
+  if (!guard_.IsValid())
+    return;
+  guard_.GetPage()->WUnlatch();
+  guard_.Drop();
+}
+
+} // namespace cmudb
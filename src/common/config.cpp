@@ -4,4 +4,7 @@ namespace cmudb {
   std::atomic<bool> ENABLE_LOGGING(false);  // for virtual table
   std::chrono::duration<long long int> LOG_TIMEOUT =
    std::chrono::seconds(1);
+  std::chrono::milliseconds FLUSH_TIMEOUT = std::chrono::milliseconds(100);
+  std::chrono::milliseconds FRAME_WAIT_TIMEOUT =
+   std::chrono::milliseconds(1000);
 }
@@ -0,0 +1,103 @@
+/**
+ * crc32c.cpp
+ */
+#include <cstring>
+
+#include "common/crc32c.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <nmmintrin.h>
+#define HAVE_SSE42_CRC32
+#endif
+
+namespace cmudb {
+
+namespace {
+
+// reflected Castagnoli polynomial
+const uint32_t POLY = 0x82f63b78;
+
+// tables_[k][b]: crc of byte b followed by k zero bytes
+struct Crc32cTables {
+  uint32_t tables_[8][256];
+  Crc32cTables() {
+    for (uint32_t b = 0; b < 256; ++b) {
+      uint32_t crc = b;
+      for (int i = 0; i < 8; ++i)
+        crc = (crc >> 1) ^ (crc & 1 ? POLY : 0);
+      tables_[0][b] = crc;
+    }
+    for (uint32_t b = 0; b < 256; ++b) {
+      for (int k = 1; k < 8; ++k)
+        tables_[k][b] = (tables_[k - 1][b] >> 8) ^
+                        tables_[0][tables_[k - 1][b] & 0xff];
+    }
+  }
+};
+
+const Crc32cTables &GetTables() {
+  static const Crc32cTables tables;
+  return tables;
+}
+
+#ifdef HAVE_SSE42_CRC32
+__attribute__((target("sse4.2"))) uint32_t
+Crc32cHardware(const char *data, size_t size, uint32_t crc) {
+  uint64_t crc64 = ~crc;
+  for (; size >= 8; data += 8, size -= 8) {
+    uint64_t word;
+    memcpy(&word, data, sizeof(word));
+    crc64 = _mm_crc32_u64(crc64, word);
+  }
+  uint32_t crc32 = static_cast<uint32_t>(crc64);
+  for (; size > 0; ++data, --size)
+    crc32 = _mm_crc32_u8(crc32, static_cast<uint8_t>(*data));
+  return ~crc32;
+}
+#endif
+
+bool DetectHardware() {
+#ifdef HAVE_SSE42_CRC32
+  return __builtin_cpu_supports("sse4.2");
+#else
+  return false;
+#endif
+}
+
+} // namespace
+
+uint32_t Crc32cPortable(const char *data, size_t size, uint32_t crc) {
+  const auto &t = GetTables().tables_;
+  crc = ~crc;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  // slicing by eight, the first four bytes of a word line up with the crc
+  for (; size >= 8; data += 8, size -= 8) {
+    uint32_t low, high;
+    memcpy(&low, data, sizeof(low));
+    memcpy(&high, data + 4, sizeof(high));
+    low ^= crc;
+    crc = t[7][low & 0xff] ^ t[6][(low >> 8) & 0xff] ^
+          t[5][(low >> 16) & 0xff] ^ t[4][low >> 24] ^
+          t[3][high & 0xff] ^ t[2][(high >> 8) & 0xff] ^
+          t[1][(high >> 16) & 0xff] ^ t[0][high >> 24];
+  }
+#endif
+  for (; size > 0; ++data, --size)
+    crc = (crc >> 8) ^ t[0][(crc ^ static_cast<uint8_t>(*data)) & 0xff];
+  return ~crc;
+}
+
+bool Crc32cIsAccelerated() {
+  static const bool accelerated = DetectHardware();
+  return accelerated;
+}
+
+uint32_t Crc32c(const char *data, size_t size, uint32_t crc) {
+#ifdef HAVE_SSE42_CRC32
+  if (Crc32cIsAccelerated())
+    return Crc32cHardware(data, size, crc);
+#endif
+  return Crc32cPortable(data, size, crc);
+}
+
+} // namespace cmudb
@@ -0,0 +1,177 @@
+/**
+ * trace.cpp
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#include "common/trace.h"
+
+namespace cmudb {
+
+namespace {
+
+// all rings ever handed out, rings of finished threads are reused by new
+// threads, so their last events stay around until they are overwritten
+struct TraceRegistry {
+  std::mutex latch_;
+  std::vector<TraceRing *> rings_;
+  std::vector<TraceRing *> free_rings_;
+  uint32_t next_thread_ = 0;
+};
+
+// never destroyed, threads may still trace during static destruction
+TraceRegistry &GetRegistry() {
+  static TraceRegistry *registry = new TraceRegistry;
+  return *registry;
+}
+
+// gives the ring of a thread back when the thread ends
+struct TraceRingOwner {
+  TraceRing *ring_ = nullptr;
+  ~TraceRingOwner() {
+    if (ring_ == nullptr)
+      return;
+    TraceRegistry &registry = GetRegistry();
+    std::lock_guard<std::mutex> guard(registry.latch_);
+    registry.free_rings_.push_back(ring_);
+  }
+};
+
+const char *GetLevelName(int level) {
+  switch (level) {
+  case LOG_LEVEL_INFO:
+    return "INFO ";
+  case LOG_LEVEL_DEBUG:
+    return "DEBUG";
+  case LOG_LEVEL_TRACE:
+    return "TRACE";
+  default:
+    return "UNKWN";
+  }
+}
+
+} // namespace
+
+/*
+ * Helper to find the ring of the calling thread, the registry latch is only
+ * taken by the first event of a thread
+ */
+TraceRing *Tracer::GetThreadRing() {
+  thread_local TraceRingOwner owner;
+  if (owner.ring_ != nullptr)
+    return owner.ring_;
+  TraceRegistry &registry = GetRegistry();
+  std::lock_guard<std::mutex> guard(registry.latch_);
+  if (registry.free_rings_.empty()) {
+    TraceRing *ring = new TraceRing;
+    for (auto &event : ring->events_)
+      event.seq_.store(0, std::memory_order_relaxed);
+    ring->next_.store(0, std::memory_order_relaxed);
+    registry.rings_.push_back(ring);
+    registry.free_rings_.push_back(ring);
+  }
+  owner.ring_ = registry.free_rings_.back();
+  registry.free_rings_.pop_back();
+  owner.ring_->thread_ = registry.next_thread_++;
+  return owner.ring_;
+}
+
+/*
+ * Append an event to the ring of the calling thread. Readers check the
+ * sequence number of an event before and after copying it, so an event being
+ * overwritten meanwhile is skipped instead of read half written.
+ */
+void Tracer::Record(int level, const char *format, const int64_t *args,
+                    size_t num_args) {
+  TraceRing *ring = GetThreadRing();
+  uint64_t seq = ring->next_.load(std::memory_order_relaxed);
+  TraceEvent &event = ring->events_[seq % TRACE_RING_SIZE];
+  event.seq_.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  event.time_ns_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now().time_since_epoch())
+                       .count();
+  event.format_ = format;
+  event.thread_ = ring->thread_;
+  event.level_ = level;
+  num_args = std::min<size_t>(num_args, TRACE_MAX_ARGS);
+  memcpy(event.args_, args, num_args * sizeof(int64_t));
+  memset(event.args_ + num_args, 0,
+         (TRACE_MAX_ARGS - num_args) * sizeof(int64_t));
+  event.seq_.store(seq + 1, std::memory_order_release);
+  ring->next_.store(seq + 1, std::memory_order_release);
+}
+
+/*
+ * Copy the events of all rings, sort them by time and format them. Threads
+ * keep tracing meanwhile, events they overwrite during the copy are dropped.
+ */
+size_t Tracer::Dump(FILE *out) {
+  static_assert(TRACE_MAX_ARGS == 4, "the formatting below passes 4 args");
+  struct Copy {
+    uint64_t time_ns_;
+    const char *format_;
+    uint32_t thread_;
+    int32_t level_;
+    int64_t args_[TRACE_MAX_ARGS];
+  };
+  std::vector<Copy> copies;
+  TraceRegistry &registry = GetRegistry();
+  {
+    std::lock_guard<std::mutex> guard(registry.latch_);
+    for (auto ring : registry.rings_) {
+      uint64_t next = ring->next_.load(std::memory_order_acquire);
+      uint64_t first = next > TRACE_RING_SIZE ? next - TRACE_RING_SIZE : 0;
+      for (uint64_t seq = first; seq < next; ++seq) {
+        TraceEvent &event = ring->events_[seq % TRACE_RING_SIZE];
+        if (event.seq_.load(std::memory_order_acquire) != seq + 1)
+          continue;
+        Copy copy;
+        copy.time_ns_ = event.time_ns_;
+        copy.format_ = event.format_;
+        copy.thread_ = event.thread_;
+        copy.level_ = event.level_;
+        memcpy(copy.args_, event.args_, sizeof(copy.args_));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (event.seq_.load(std::memory_order_relaxed) != seq + 1)
+          continue;
+        copies.push_back(copy);
+      }
+    }
+  }
+  std::stable_sort(copies.begin(), copies.end(),
+                   [](const Copy &a, const Copy &b) {
+                     return a.time_ns_ < b.time_ns_;
+                   });
+  uint64_t start = copies.empty() ? 0 : copies.front().time_ns_;
+  for (auto &copy : copies) {
+    fprintf(out, "%12.3f [%u] %s - ", (copy.time_ns_ - start) / 1000.0,
+            copy.thread_, GetLevelName(copy.level_));
+    fprintf(out, copy.format_, static_cast<long long>(copy.args_[0]),
+            static_cast<long long>(copy.args_[1]),
+            static_cast<long long>(copy.args_[2]),
+            static_cast<long long>(copy.args_[3]));
+    fputc('\n', out);
+  }
+  fflush(out);
+  return copies.size();
+}
+
+/*
+ * Drop all recorded events. Meant for tests and tools between two runs, the
+ * calling thread must be the only one tracing.
+ */
+void Tracer::Clear() {
+  TraceRegistry &registry = GetRegistry();
+  std::lock_guard<std::mutex> guard(registry.latch_);
+  for (auto ring : registry.rings_) {
+    for (auto &event : ring->events_)
+      event.seq_.store(0, std::memory_order_relaxed);
+    ring->next_.store(0, std::memory_order_relaxed);
+  }
+}
+
+} // namespace cmudb
@@ -0,0 +1,358 @@
+/**
+ * async_io.cpp
+ */
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "common/config.h"
+#include "common/logger.h"
+#include "disk/async_io.h"
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup)
+#include <linux/io_uring.h>
+#define HAVE_IO_URING
+#endif
+#endif
+
+namespace cmudb {
+
+size_t ReadAt(int fd, char *data, size_t size, size_t offset) {
+  size_t done = 0;
+  while (done < size) {
+    ssize_t n = pread(fd, data + done, size - done, offset + done);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      break;
+    done += n;
+  }
+  return done;
+}
+
+size_t WriteAt(int fd, const char *data, size_t size, size_t offset) {
+  size_t done = 0;
+  while (done < size) {
+    ssize_t n = pwrite(fd, data + done, size - done, offset + done);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      break;
+    done += n;
+  }
+  return done;
+}
+
+/*
+ * Helper to finish request synchronously once the engine transferred done
+ * bytes, which covers short transfers and requests the kernel refused
+ * return true unless a write could not be completed
+ */
+static bool FinishRequest(AsyncIORequest &request, size_t done) {
+  if (done < request.size_) {
+    done += request.write_
+                ? WriteAt(request.fd_, request.data_ + done,
+                          request.size_ - done, request.offset_ + done)
+                : ReadAt(request.fd_, request.data_ + done,
+                         request.size_ - done, request.offset_ + done);
+  }
+  if (done == request.size_)
+    return true;
+  if (request.write_)
+    return false;
+  // read beyond the end of the file
+  memset(request.data_ + done, 0, request.size_ - done);
+  return true;
+}
+
+AsyncIOEngine *AsyncIOEngine::Create(size_t queue_depth) {
+  IOUringEngine *ring = new IOUringEngine(queue_depth);
+  if (ring->IsReady())
+    return ring;
+  delete ring;
+  LOG_DEBUG("io_uring not available, using %d I/O threads", ASYNC_IO_THREADS);
+  return new ThreadPoolEngine(queue_depth, ASYNC_IO_THREADS);
+}
+
+void AsyncIOEngine::Drain() {
+  std::unique_lock<std::mutex> lck(latch_);
+  room_cv_.wait(lck, [this] { return in_flight_ == 0; });
+}
+
+/*
+ * Helper to wait until another request may be started, caller must hold
+ * latch_ through lck
+ */
+void AsyncIOEngine::WaitForRoom(std::unique_lock<std::mutex> &lck) {
+  room_cv_.wait(lck, [this] { return in_flight_ < queue_depth_; });
+}
+
+/*
+ * Helper to run the callback of a finished request, without latch_ so that
+ * callbacks may take other latches, then to make room for the next one
+ */
+void AsyncIOEngine::Complete(AsyncIORequest &request, bool ok) {
+  if (request.done_)
+    request.done_(ok);
+  std::lock_guard<std::mutex> guard(latch_);
+  --in_flight_;
+  room_cv_.notify_all();
+}
+
+/*****************************************************************************
+ * THREAD POOL
+ *****************************************************************************/
+ThreadPoolEngine::ThreadPoolEngine(size_t queue_depth, size_t num_threads)
+    : AsyncIOEngine(queue_depth) {
+  for (size_t i = 0; i < std::max<size_t>(num_threads, 1); ++i)
+    workers_.push_back(std::thread(&ThreadPoolEngine::RunWorker, this));
+}
+
+ThreadPoolEngine::~ThreadPoolEngine() {
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    stop_ = true;
+  }
+  queue_cv_.notify_all();
+  for (auto &worker : workers_)
+    worker.join();
+}
+
+void ThreadPoolEngine::Submit(std::vector<AsyncIORequest> &requests) {
+  std::unique_lock<std::mutex> lck(latch_);
+  for (auto &request : requests) {
+    WaitForRoom(lck);
+    ++in_flight_;
+    queue_.push_back(std::move(request));
+    queue_cv_.notify_one();
+  }
+  requests.clear();
+}
+
+/*
+ * Body of a worker, queued requests are still served after stop_ is set
+ */
+void ThreadPoolEngine::RunWorker() {
+  std::unique_lock<std::mutex> lck(latch_);
+  while (true) {
+    queue_cv_.wait(lck, [this] { return stop_ || !queue_.empty(); });
+    if (queue_.empty())
+      return;
+    AsyncIORequest request = std::move(queue_.front());
+    queue_.pop_front();
+    lck.unlock();
+    bool ok = FinishRequest(request, 0);
+    Complete(request, ok);
+    lck.lock();
+  }
+}
+
+/*****************************************************************************
+ * IO_URING
+ *****************************************************************************/
+// user_data of the entry that stops the reaper
+static const uint64_t STOP_REAPER = UINT64_MAX;
+
+/*
+ * Set up a ring with room for queue_depth submissions. Reads and writes
+ * without iovecs need Linux 5.6, older kernels are treated like kernels
+ * without io_uring.
+ */
+IOUringEngine::IOUringEngine(size_t queue_depth) : AsyncIOEngine(queue_depth) {
+#ifdef HAVE_IO_URING
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  ring_fd_ = syscall(__NR_io_uring_setup, queue_depth, &params);
+  if (ring_fd_ < 0)
+    return;
+  if ((params.features & IORING_FEAT_RW_CUR_POS) == 0 ||
+      params.sq_entries < queue_depth) {
+    CloseRing();
+    return;
+  }
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_ring_size_ =
+      params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_mmap)
+    sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+  sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  cq_ring_ = single_mmap ? sq_ring_
+                         : mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                                MAP_SHARED | MAP_POPULATE, ring_fd_,
+                                IORING_OFF_CQ_RING);
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  sqes_ = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+  if (sq_ring_ == MAP_FAILED || cq_ring_ == MAP_FAILED ||
+      sqes_ == MAP_FAILED) {
+    CloseRing();
+    return;
+  }
+  char *sq = static_cast<char *>(sq_ring_);
+  sq_head_ = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+  sq_tail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+  sq_mask_ = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+  sq_array_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+  char *cq = static_cast<char *>(cq_ring_);
+  cq_head_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+  cq_mask_ = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+  cqes_ = cq + params.cq_off.cqes;
+
+  // the completion queue is twice as large, it can never overflow
+  slots_.resize(queue_depth);
+  for (size_t i = queue_depth; i > 0; --i)
+    free_slots_.push_back(i - 1);
+  reaper_ = new std::thread(&IOUringEngine::RunReaper, this);
+#endif
+}
+
+IOUringEngine::~IOUringEngine() {
+  if (reaper_ != nullptr) {
+    Drain();
+    {
+      std::lock_guard<std::mutex> guard(latch_);
+      PushEntry(nullptr, STOP_REAPER);
+      Enter(0);
+    }
+    reaper_->join();
+    delete reaper_;
+  }
+  CloseRing();
+}
+
+/*
+ * Helper to unmap the rings and close the ring descriptor
+ */
+void IOUringEngine::CloseRing() {
+  if (sqes_ != nullptr && sqes_ != MAP_FAILED)
+    munmap(sqes_, sqes_size_);
+  if (cq_ring_ != nullptr && cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_)
+    munmap(cq_ring_, cq_ring_size_);
+  if (sq_ring_ != nullptr && sq_ring_ != MAP_FAILED)
+    munmap(sq_ring_, sq_ring_size_);
+  sqes_ = cq_ring_ = sq_ring_ = nullptr;
+  if (ring_fd_ >= 0)
+    close(ring_fd_);
+  ring_fd_ = -1;
+}
+
+/*
+ * Start all requests with a single system call unless the queue fills up
+ * on the way
+ */
+void IOUringEngine::Submit(std::vector<AsyncIORequest> &requests) {
+  std::unique_lock<std::mutex> lck(latch_);
+  bool pending = false;
+  for (auto &request : requests) {
+    if (in_flight_ == queue_depth_ && pending) {
+      // what is queued so far has to go out before anything can complete
+      Enter(0);
+      pending = false;
+    }
+    WaitForRoom(lck);
+    ++in_flight_;
+    unsigned slot = free_slots_.back();
+    free_slots_.pop_back();
+    slots_[slot] = std::move(request);
+    PushEntry(&slots_[slot], slot);
+    pending = true;
+  }
+  if (pending)
+    Enter(0);
+  requests.clear();
+}
+
+/*
+ * Helper to append a submission entry for request, or a no-op if request is
+ * nullptr, caller must hold latch_. The kernel sees it with the next Enter().
+ */
+void IOUringEngine::PushEntry(const AsyncIORequest *request,
+                              uint64_t user_data) {
+#ifdef HAVE_IO_URING
+  unsigned tail = *sq_tail_;
+  unsigned index = tail & *sq_mask_;
+  io_uring_sqe *sqe = static_cast<io_uring_sqe *>(sqes_) + index;
+  memset(sqe, 0, sizeof(*sqe));
+  if (request == nullptr) {
+    sqe->opcode = IORING_OP_NOP;
+  } else {
+    sqe->opcode = request->write_ ? IORING_OP_WRITE : IORING_OP_READ;
+    sqe->fd = request->fd_;
+    sqe->addr = reinterpret_cast<uint64_t>(request->data_);
+    sqe->len = request->size_;
+    sqe->off = request->offset_;
+  }
+  sqe->user_data = user_data;
+  sq_array_[index] = index;
+  __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+#endif
+}
+
+/*
+ * Helper to hand all pushed entries to the kernel and, with min_complete > 0,
+ * to wait for that many completions. Submitting needs latch_, waiting must
+ * not hold it.
+ * return false on an unexpected error of the system call
+ */
+bool IOUringEngine::Enter(unsigned min_complete) {
+#ifdef HAVE_IO_URING
+  while (true) {
+    unsigned to_submit = 0;
+    if (min_complete == 0)
+      to_submit = *sq_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    int ret = syscall(__NR_io_uring_enter, ring_fd_, to_submit, min_complete,
+                      min_complete > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr,
+                      0);
+    if (ret >= 0 && (min_complete > 0 || static_cast<unsigned>(ret) >= to_submit))
+      return true;
+    if (ret < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+      LOG_DEBUG("io_uring_enter failed: %s", strerror(errno));
+      return false;
+    }
+  }
+#else
+  return false;
+#endif
+}
+
+/*
+ * Body of the completion thread, finishes requests in the order the kernel
+ * completes them until the stop entry comes back
+ */
+void IOUringEngine::RunReaper() {
+#ifdef HAVE_IO_URING
+  while (true) {
+    // only this thread moves the head
+    unsigned head = *cq_head_;
+    if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+      if (!Enter(1))
+        std::this_thread::yield();
+      continue;
+    }
+    io_uring_cqe *cqe = static_cast<io_uring_cqe *>(cqes_) + (head & *cq_mask_);
+    uint64_t user_data = cqe->user_data;
+    int res = cqe->res;
+    __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+    if (user_data == STOP_REAPER)
+      return;
+    AsyncIORequest request;
+    {
+      std::lock_guard<std::mutex> guard(latch_);
+      request = std::move(slots_[user_data]);
+      free_slots_.push_back(user_data);
+    }
+    // a refused request (res < 0) is done synchronously
+    bool ok = FinishRequest(request, res < 0 ? 0 : res);
+    Complete(request, ok);
+  }
+#endif
+}
+
+} // namespace cmudb
@@ -1,26 +1,56 @@
 /**
  * disk_manager.cpp
  */
+#include <algorithm>
 #include <assert.h>
+#include <cerrno>
+#include <climits>
+#include <condition_variable>
 #include <cstring>
+#include <fcntl.h>
 #include <iostream>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
 #include <thread>
+#include <vector>
 
+#include "common/crc32c.h"
+#include "common/exception.h"
 #include "common/logger.h"
+#include "disk/async_io.h"
 #include "disk/disk_manager.h"
 
 namespace cmudb {
 
 static char *buffer_used = nullptr;
 
+static const uint32_t META_MAGIC = 0x42444d43; // "CMDB"
+static const uint32_t META_VERSION = 3;
+static const uint32_t FREE_TRUNK_MAGIC = 0x45455246; // "FREE"
+
 /**
  * Constructor: open/create a single database file & log file
  * @input db_file: database file name
+ * @input page_size: page size of a database file created here
+ * @input read_only: map an existing database file instead, no log file is
+ * opened
  */
-DiskManager::DiskManager(const std::string &db_file)
-    : file_name_(db_file), next_page_id_(0), num_flushes_(0), flush_log_(false),
-      flush_log_f_(nullptr) {
+DiskManager::DiskManager(const std::string &db_file, size_t page_size,
+                         bool read_only)
+    : db_fd_(-1), file_name_(db_file), page_size_(PAGE_SIZE), data_offset_(0),
+      checksums_(false), num_checksum_failures_(0), next_page_id_(0), free_trunk_(INVALID_PAGE_ID), num_free_pages_(0),
+      mapping_(nullptr), mapping_size_(0),
+      num_mapped_pages_(0), async_io_(nullptr), num_flushes_(0),
+      flush_log_(false), flush_log_f_(nullptr) {
+  if (page_size < MIN_PAGE_SIZE || page_size > MAX_PAGE_SIZE ||
+      (page_size & (page_size - 1)) != 0) {
+    throw Exception(EXCEPTION_TYPE_OUT_OF_RANGE,
+                    "page size must be a power of two between " +
+                        std::to_string(MIN_PAGE_SIZE) + " and " +
+                        std::to_string(MAX_PAGE_SIZE));
+  }
   std::string::size_type n = file_name_.find(".");
   if (n == std::string::npos) {
     LOG_DEBUG("wrong file format");
@@ -28,6 +58,16 @@ DiskManager::DiskManager(const std::string &db_file)
   }
   log_name_ = file_name_.substr(0, n) + ".log";
 
+  if (read_only) {
+    db_fd_ = open(db_file.c_str(), O_RDONLY);
+    if (db_fd_ < 0 || GetFileSize(file_name_) <= 0)
+      throw Exception(EXCEPTION_TYPE_INVALID,
+                      "can't open " + file_name_ + " read-only");
+    OpenMetaBlock(page_size);
+    MapFile();
+    return;
+  }
+
   log_io_.open(log_name_,
                std::ios::binary | std::ios::in | std::ios::app | std::ios::out);
   // directory or file does not exist
@@ -42,21 +82,181 @@ DiskManager::DiskManager(const std::string &db_file)
                                 std::ios::out);
   }
 
-  db_io_.open(db_file,
-              std::ios::binary | std::ios::in | std::ios::out | std::ios::out);
-  // directory or file does not exist
-  if (!db_io_.is_open()) {
-    db_io_.clear();
-    // create a new file
-    db_io_.open(db_file, std::ios::binary | std::ios::trunc | std::ios::out);
-    db_io_.close();
-    // reopen with original mode
-    db_io_.open(db_file, std::ios::binary | std::ios::in | std::ios::out);
+  // create the file if it does not exist
+  db_fd_ = open(db_file.c_str(), O_RDWR | O_CREAT, 0644);
+  if (db_fd_ < 0)
+    throw Exception(EXCEPTION_TYPE_INVALID, "can't open " + file_name_);
+  OpenMetaBlock(page_size);
+}
+
+/**
+ * Private helper: create the meta block of a new database file, or take the
+ * page size, the next page id and the free list from the meta block of an
+ * existing one. The meta block occupies one page so that the pages stay
+ * aligned to their size.
+ */
+void DiskManager::OpenMetaBlock(size_t page_size) {
+  int file_size = GetFileSize(file_name_);
+  if (file_size <= 0) {
+    page_size_ = page_size;
+    data_offset_ = page_size_;
+    checksums_ = true;
+    WriteMetaBlock();
+    return;
+  }
+  MetaBlock meta;
+  memset(&meta, 0, sizeof(meta));
+  // a version 1 meta block ends after page_size_, the rest reads as zeros
+  if (ReadAt(db_fd_, reinterpret_cast<char *>(&meta), sizeof(meta), 0) ==
+          sizeof(meta) &&
+      meta.magic_ == META_MAGIC &&
+      meta.version_ >= 1 && meta.version_ <= META_VERSION &&
+      meta.page_size_ >= MIN_PAGE_SIZE && meta.page_size_ <= MAX_PAGE_SIZE) {
+    page_size_ = meta.page_size_;
+    data_offset_ = page_size_;
+    checksums_ = meta.version_ == META_VERSION;
+    // a damaged meta block could point the free list at live pages
+    if (checksums_ && !ReadMetaChecksum()) {
+      close(db_fd_);
+      db_fd_ = -1;
+      throw Exception(EXCEPTION_TYPE_INVALID,
+                      "meta block of " + file_name_ + " fails its checksum");
+    }
+  } else {
+    LOG_DEBUG("no meta block, assuming %d byte pages", PAGE_SIZE);
+    meta.version_ = 0;
   }
+  // pages allocated but never written are not in the file, older files only
+  // know the pages in the file
+  page_id_t file_pages = GetNumPages();
+  if (meta.version_ >= 2) {
+    next_page_id_ = std::max(meta.next_page_id_, file_pages);
+    OpenFreeList(meta.free_trunk_);
+  } else {
+    next_page_id_ = file_pages;
+  }
+}
+
+/**
+ * Private helper: record the next page id and the first trunk in the meta
+ * block, caller must hold free_latch_ unless nobody else can see the disk
+ * manager yet. With checksums the whole first page is written, stamped like
+ * a page with id INVALID_PAGE_ID. Files without checksums stay at version 2.
+ */
+void DiskManager::WriteMetaBlock() {
+  if (data_offset_ == 0 || mapping_ != nullptr)
+    return;
+  MetaBlock meta{META_MAGIC, checksums_ ? META_VERSION : 2,
+                 static_cast<uint32_t>(page_size_), next_page_id_,
+                 free_trunk_};
+  if (!checksums_) {
+    if (WriteAt(db_fd_, reinterpret_cast<const char *>(&meta), sizeof(meta),
+                0) < sizeof(meta)) {
+      LOG_DEBUG("I/O error while writing meta block");
+    }
+    return;
+  }
+  std::vector<char> block(page_size_, 0);
+  memcpy(block.data(), &meta, sizeof(meta));
+  StampPage(INVALID_PAGE_ID, block.data());
+  if (WriteAt(db_fd_, block.data(), page_size_, 0) < page_size_) {
+    LOG_DEBUG("I/O error while writing meta block");
+  }
+}
+
+/**
+ * Private helper: read the whole meta block of a file with checksums
+ * return false if it fails its checksum
+ */
+bool DiskManager::ReadMetaChecksum() {
+  std::vector<char> block(page_size_);
+  return ReadAt(db_fd_, block.data(), page_size_, 0) == page_size_ &&
+         ChecksumMatches(INVALID_PAGE_ID, block.data());
+}
+
+/**
+ * Private helper: load the first trunk of the free list and count the free
+ * pages of all trunks. A trunk which cannot be read ends the list, its pages
+ * are lost but never handed out twice.
+ */
+void DiskManager::OpenFreeList(page_id_t free_trunk) {
+  trunk_.assign(page_size_, 0);
+  std::vector<char> first;
+  // a damaged list could run in circles, there are never more trunks than
+  // pages
+  page_id_t num_trunks = 0;
+  for (page_id_t page_id = free_trunk; page_id != INVALID_PAGE_ID;
+       page_id = GetTrunk()->next_trunk_) {
+    if (++num_trunks > next_page_id_ || !ReadTrunk(page_id)) {
+      LOG_DEBUG("free list trunk %d is damaged", page_id);
+      break;
+    }
+    if (first.empty()) {
+      first = trunk_;
+      free_trunk_ = page_id;
+    }
+    num_free_pages_ += GetTrunk()->count_ + 1;
+  }
+  if (!first.empty())
+    trunk_.swap(first);
+}
+
+/**
+ * Private helper: read the trunk page_id into trunk_
+ * return false if page_id holds no trunk
+ */
+bool DiskManager::ReadTrunk(page_id_t page_id) {
+  if (page_id < 0 || page_id >= next_page_id_ ||
+      ReadAt(db_fd_, trunk_.data(), page_size_, GetPageOffset(page_id)) <
+          page_size_ ||
+      !ChecksumMatches(page_id, trunk_.data()))
+    return false;
+  FreeTrunk *trunk = GetTrunk();
+  return trunk->magic_ == FREE_TRUNK_MAGIC &&
+         trunk->count_ <= GetTrunkCapacity();
+}
+
+/**
+ * Private helper: write trunk_ back to the first trunk page, caller must hold
+ * free_latch_
+ */
+void DiskManager::WriteTrunk() {
+  StampPage(free_trunk_, trunk_.data());
+  unwritten_.erase(free_trunk_);
+  if (WriteAt(db_fd_, trunk_.data(), page_size_,
+              GetPageOffset(free_trunk_)) < page_size_) {
+    LOG_DEBUG("I/O error while writing free list");
+  }
+}
+
+/**
+ * Private helper: map the whole pages of the db file read-only
+ */
+void DiskManager::MapFile() {
+  int file_size = GetFileSize(file_name_);
+  if (file_size > static_cast<int>(data_offset_))
+    num_mapped_pages_ = (file_size - data_offset_) / page_size_;
+  mapping_size_ = data_offset_ + num_mapped_pages_ * page_size_;
+  void *mapping =
+      mmap(nullptr, mapping_size_, PROT_READ, MAP_SHARED, db_fd_, 0);
+  if (mapping == MAP_FAILED)
+    throw Exception(EXCEPTION_TYPE_INVALID, "can't map " + file_name_);
+  mapping_ = static_cast<char *>(mapping);
 }
 
 DiskManager::~DiskManager() {
-  db_io_.close();
+  if (!IsReadOnly())
+    ReleaseExtents();
+  WriteMetaBlock();
+  AsyncIOEngine *async_io = async_io_.load();
+  if (async_io != nullptr) {
+    async_io->Drain();
+    delete async_io;
+  }
+  if (mapping_ != nullptr)
+    munmap(mapping_, mapping_size_);
+  if (db_fd_ >= 0)
+    close(db_fd_);
   log_io_.close();
 }
 
@@ -64,43 +264,314 @@ DiskManager::~DiskManager() {
  * Write the contents of the specified page into disk file
  */
 void DiskManager::WritePage(page_id_t page_id, const char *page_data) {
-  size_t offset = page_id * PAGE_SIZE;
+  if (IsReadOnly()) {
+    LOG_DEBUG("write to read-only database");
+    return;
+  }
+  size_t offset = GetPageOffset(page_id);
 //  LOG_DEBUG("page_id= %d, offset = %lu, file_size= %d",page_id, offset, GetFileSize(file_name_));
-  // set write cursor to offset
-  db_io_.seekp(offset);
-  db_io_.write(page_data, PAGE_SIZE);
+  // the checksum has to match what is written, even if the caller goes on
+  // changing the page
+  thread_local std::vector<char> copy;
+  if (checksums_) {
+    copy.assign(page_data, page_data + page_size_);
+    StampPage(page_id, copy.data());
+    page_data = copy.data();
+  }
   // check for I/O error
-  if (db_io_.bad()) {
+  if (WriteAt(db_fd_, page_data, page_size_, offset) < page_size_) {
     LOG_DEBUG("I/O error while writing");
+  }
+  MarkWritten(page_id, 1);
+}
+
+/**
+ * Write a run of adjacent pages, gathered into as few pwritev() calls as the
+ * system allows. With checksums the pages are stamped in copies, one call's
+ * worth at a time. Nothing is synced until Sync() is called.
+ */
+void DiskManager::WritePages(page_id_t page_id, const char *const *pages_data,
+                             size_t count) {
+  if (IsReadOnly()) {
+    LOG_DEBUG("write to read-only database");
     return;
   }
-  // needs to flush to keep disk file in sync
-  db_io_.flush();
+  size_t offset = GetPageOffset(page_id);
+  std::vector<iovec> iov(std::min<size_t>(count, IOV_MAX));
+  std::vector<char> copies(checksums_ ? iov.size() * page_size_ : 0);
+  for (size_t start = 0; start < count; start += iov.size()) {
+    size_t n = std::min(count - start, iov.size());
+    for (size_t i = 0; i < n; ++i) {
+      char *data = const_cast<char *>(pages_data[start + i]);
+      if (checksums_) {
+        data = copies.data() + i * page_size_;
+        memcpy(data, pages_data[start + i], page_size_);
+        StampPage(page_id + start + i, data);
+      }
+      iov[i] = iovec{data, page_size_};
+    }
+    ssize_t written;
+    do {
+      written = pwritev(db_fd_, iov.data(), n, offset + start * page_size_);
+    } while (written < 0 && errno == EINTR);
+    // finish a short write page by page
+    size_t done = written < 0 ? 0 : written;
+    for (size_t i = done / page_size_; i < n; ++i) {
+      size_t skip = i == done / page_size_ ? done % page_size_ : 0;
+      size_t page_offset = offset + (start + i) * page_size_ + skip;
+      if (WriteAt(db_fd_, static_cast<char *>(iov[i].iov_base) + skip,
+                  page_size_ - skip, page_offset) < page_size_ - skip) {
+        LOG_DEBUG("I/O error while writing");
+        MarkWritten(page_id, start);
+        return;
+      }
+    }
+  }
+  MarkWritten(page_id, count);
+}
+
+/**
+ * Read a run of adjacent pages, scattered into as few preadv() calls as the
+ * system allows. Pages beyond the end of the file are filled with zeros.
+ * return false if any page fails its checksum
+ */
+bool DiskManager::ReadPages(page_id_t page_id, char *const *pages_data,
+                            size_t count, bool *intact) {
+  size_t offset = GetPageOffset(page_id);
+  std::vector<iovec> iov(std::min<size_t>(count, IOV_MAX));
+  for (size_t start = 0; start < count; start += iov.size()) {
+    size_t n = std::min(count - start, iov.size());
+    for (size_t i = 0; i < n; ++i)
+      iov[i] = iovec{pages_data[start + i], page_size_};
+    ssize_t read_count;
+    do {
+      read_count = preadv(db_fd_, iov.data(), n, offset + start * page_size_);
+    } while (read_count < 0 && errno == EINTR);
+    // finish a short read page by page
+    size_t done = read_count < 0 ? 0 : read_count;
+    for (size_t i = done / page_size_; i < n; ++i) {
+      size_t skip = i == done / page_size_ ? done % page_size_ : 0;
+      size_t page_offset = offset + (start + i) * page_size_ + skip;
+      size_t rest = ReadAt(db_fd_, pages_data[start + i] + skip,
+                           page_size_ - skip, page_offset);
+      memset(pages_data[start + i] + skip + rest, 0, page_size_ - skip - rest);
+    }
+  }
+  bool all_intact = true;
+  for (size_t i = 0; i < count; ++i) {
+    bool ok = VerifyPage(page_id + i, pages_data[i]);
+    if (intact != nullptr)
+      intact[i] = ok;
+    all_intact = all_intact && ok;
+  }
+  return all_intact;
+}
+
+/**
+ * Page writes go straight to the kernel, make them durable together with the
+ * next page id
+ */
+void DiskManager::Sync() {
+  if (IsReadOnly())
+    return;
+  {
+    std::lock_guard<std::mutex> guard(free_latch_);
+    WriteMetaBlock();
+  }
+  if (fdatasync(db_fd_) != 0) {
+    LOG_DEBUG("I/O error while syncing");
+  }
+}
+
+/**
+ * Private helper: the asynchronous I/O engine, started by the first caller
+ */
+AsyncIOEngine *DiskManager::GetAsyncIO() {
+  std::call_once(async_io_once_, [this] {
+    AsyncIOEngine *async_io = AsyncIOEngine::Create(ASYNC_IO_QUEUE_DEPTH);
+    LOG_DEBUG("asynchronous I/O through %s", async_io->GetName());
+    async_io_.store(async_io);
+  });
+  return async_io_.load();
+}
+
+/**
+ * Start a batch of page reads and writes. With io_uring the whole batch
+ * reaches the kernel in one system call; it only blocks while more than
+ * ASYNC_IO_QUEUE_DEPTH transfers are in flight. Reads past the end of the
+ * file are filled up with zeros like in ReadPage(). Writes go out from
+ * stamped copies, reads are verified before done_ is called.
+ */
+void DiskManager::SubmitPageIO(std::vector<PageIO> &batch) {
+  std::vector<AsyncIORequest> requests;
+  requests.reserve(batch.size());
+  for (auto &io : batch) {
+    if (io.write_ && IsReadOnly()) {
+      LOG_DEBUG("write to read-only database");
+      if (io.done_)
+        io.done_(false);
+      continue;
+    }
+    char *data = io.data_;
+    std::function<void(bool)> done = std::move(io.done_);
+    if (checksums_ && io.write_) {
+      auto copy = std::make_shared<std::vector<char>>(data, data + page_size_);
+      StampPage(io.page_id_, copy->data());
+      data = copy->data();
+      page_id_t page_id = io.page_id_;
+      done = [this, copy, page_id, done](bool ok) {
+        if (ok)
+          MarkWritten(page_id, 1);
+        if (done)
+          done(ok);
+      };
+    } else if (checksums_) {
+      page_id_t page_id = io.page_id_;
+      done = [this, page_id, data, done](bool ok) {
+        ok = ok && VerifyPage(page_id, data);
+        if (done)
+          done(ok);
+      };
+    }
+    requests.push_back(AsyncIORequest{db_fd_, io.write_, data, page_size_,
+                                      GetPageOffset(io.page_id_),
+                                      std::move(done)});
+  }
+  batch.clear();
+  if (!requests.empty())
+    GetAsyncIO()->Submit(requests);
+}
+
+/**
+ * SubmitPageIO() for callers which need the pages before they go on, like a
+ * flush writing a set of pages back. Only this batch is waited for, not the
+ * transfers other threads have in flight.
+ */
+bool DiskManager::RunPageIO(std::vector<PageIO> &batch) {
+  struct Pending {
+    std::mutex latch_;
+    std::condition_variable cv_;
+    size_t left_;
+    bool ok_;
+  };
+  auto pending = std::make_shared<Pending>();
+  pending->left_ = batch.size();
+  pending->ok_ = true;
+  for (auto &io : batch) {
+    auto done = std::move(io.done_);
+    io.done_ = [pending, done](bool ok) {
+      if (done)
+        done(ok);
+      std::lock_guard<std::mutex> guard(pending->latch_);
+      pending->ok_ = pending->ok_ && ok;
+      if (--pending->left_ == 0)
+        pending->cv_.notify_all();
+    };
+  }
+  SubmitPageIO(batch);
+  std::unique_lock<std::mutex> lck(pending->latch_);
+  pending->cv_.wait(lck, [&pending] { return pending->left_ == 0; });
+  return pending->ok_;
+}
+
+/**
+ * Single page versions of SubmitPageIO(), the future tells whether the
+ * transfer succeeded
+ */
+std::future<bool> DiskManager::ReadPageAsync(page_id_t page_id,
+                                             char *page_data) {
+  auto promise = std::make_shared<std::promise<bool>>();
+  std::future<bool> result = promise->get_future();
+  std::vector<PageIO> batch{
+      {page_id, page_data, false, [promise](bool ok) { promise->set_value(ok); }}};
+  SubmitPageIO(batch);
+  return result;
+}
+
+std::future<bool> DiskManager::WritePageAsync(page_id_t page_id,
+                                              const char *page_data) {
+  auto promise = std::make_shared<std::promise<bool>>();
+  std::future<bool> result = promise->get_future();
+  std::vector<PageIO> batch{{page_id, const_cast<char *>(page_data), true,
+                             [promise](bool ok) { promise->set_value(ok); }}};
+  SubmitPageIO(batch);
+  return result;
+}
+
+void DiskManager::WaitForPageIO() {
+  // nothing can be in flight before the engine exists
+  AsyncIOEngine *async_io = async_io_.load();
+  if (async_io != nullptr)
+    async_io->Drain();
+}
+
+/**
+ * Content of a page of a read-only database, nullptr if the file has no such
+ * page or is not mapped
+ */
+const char *DiskManager::GetMappedPage(page_id_t page_id) const {
+  if (mapping_ == nullptr || page_id < 0 || page_id >= num_mapped_pages_)
+    return nullptr;
+  return mapping_ + GetPageOffset(page_id);
 }
 
 /**
  * Read the contents of the specified page into the given memory area
+ * return false if the page fails its checksum
  */
-void DiskManager::ReadPage(page_id_t page_id, char *page_data) {
-  int offset = page_id * PAGE_SIZE;
-//  std::cout << "ReadPage: file_name=" << file_name_ << std::endl;
+bool DiskManager::ReadPage(page_id_t page_id, char *page_data) {
+  size_t offset = GetPageOffset(page_id);
 //  LOG_DEBUG("page_id= %d, offset = %d, file_size= %d",page_id, offset, GetFileSize(file_name_));
-  // check if read beyond file length
-  if (offset > GetFileSize(file_name_)) {
-    LOG_DEBUG("I/O error while reading");
-    // std::cerr << "I/O error while reading" << std::endl;
-  } else {
-    // set read cursor to offset
-    db_io_.seekp(offset);
-    db_io_.read(page_data, PAGE_SIZE);
-    // if file ends before reading PAGE_SIZE
-    int read_count = db_io_.gcount();
-    if (read_count < PAGE_SIZE) {
-      LOG_DEBUG("Read less than a page");
-      // std::cerr << "Read less than a page" << std::endl;
-      memset(page_data + read_count, 0, PAGE_SIZE - read_count);
-    }
+  size_t read_count = ReadAt(db_fd_, page_data, page_size_, offset);
+  // if file ends before reading a whole page
+  if (read_count < page_size_) {
+    LOG_DEBUG("Read less than a page");
+    // std::cerr << "Read less than a page" << std::endl;
+    memset(page_data + read_count, 0, page_size_ - read_count);
   }
+  return VerifyPage(page_id, page_data);
+}
+
+/**
+ * Private helper: fill in the trailer of a page about to be written
+ */
+void DiskManager::StampPage(page_id_t page_id, char *page_data) const {
+  if (!checksums_)
+    return;
+  size_t size = page_size_ - CHECKSUM_SIZE;
+  uint32_t crc = Crc32c(page_data, size, static_cast<uint32_t>(page_id));
+  memcpy(page_data + size, &crc, CHECKSUM_SIZE);
+}
+
+/**
+ * Private helper: compare the trailer of a page with the checksum of its
+ * content
+ */
+bool DiskManager::ChecksumMatches(page_id_t page_id,
+                                  const char *page_data) const {
+  size_t size = page_size_ - CHECKSUM_SIZE;
+  uint32_t crc = Crc32c(page_data, size, static_cast<uint32_t>(page_id));
+  uint32_t stored;
+  memcpy(&stored, page_data + size, CHECKSUM_SIZE);
+  return crc == stored;
+}
+
+/**
+ * Check the trailer of a page read from disk. A page of zeros only passes if
+ * it is known never to have been written: it is not allocated, or it was
+ * allocated since the file was opened and not written yet. Anywhere else
+ * zeros mean the content was lost. Mismatches are counted.
+ */
+bool DiskManager::VerifyPage(page_id_t page_id, const char *page_data) {
+  if (!checksums_ || ChecksumMatches(page_id, page_data))
+    return true;
+  if (page_data[0] == 0 &&
+      memcmp(page_data, page_data + 1, page_size_ - 1) == 0 &&
+      IsUnwritten(page_id))
+    return true;
+  ++num_checksum_failures_;
+  LOG_DEBUG("page %d fails its checksum", page_id);
+  return false;
 }
 
 /**
@@ -161,16 +632,189 @@ bool DiskManager::ReadLog(char *log_data, int size, int offset) {
 
 /**
  * Allocate new page (operations like create index/table)
- * For now just keep an increasing counter
+ * owner_hint: a page of the table heap or index the new page belongs to,
+ * usually the page it will be linked from, or INVALID_PAGE_ID
+ * Hinted pages are taken from the extent of the hint while it has unused
+ * pages, so chains grow contiguously on disk. A full extent is followed by a
+ * new one at the end of the file, unless at least an extent worth of pages
+ * is free: the file only grows by whole extents while there is little to
+ * reuse. Pages without hint come from the free list first, then from the end
+ * of the file.
+ * A read-only database has no room for new pages, INVALID_PAGE_ID is returned
+ */
+page_id_t DiskManager::AllocatePage(page_id_t owner_hint) {
+  if (IsReadOnly())
+    return INVALID_PAGE_ID;
+  std::lock_guard<std::mutex> guard(free_latch_);
+  page_id_t page_id;
+  if (owner_hint == INVALID_PAGE_ID)
+    page_id = free_trunk_ == INVALID_PAGE_ID ? next_page_id_++ : TakeFreePage();
+  else
+    page_id = AllocateFromExtent(owner_hint);
+  // reads of the page find zeros until it is written
+  if (checksums_)
+    unwritten_.insert(page_id);
+  return page_id;
+}
+
+/**
+ * Private helper for AllocatePage(): a page for the owner of owner_hint,
+ * caller must hold free_latch_
+ */
+page_id_t DiskManager::AllocateFromExtent(page_id_t owner_hint) {
+  auto extent = extents_.upper_bound(owner_hint);
+  if (extent != extents_.begin()) {
+    --extent;
+    if (owner_hint < extent->first + EXTENT_SIZE) {
+      page_id_t page_id = extent->second++;
+      if (extent->second == extent->first + EXTENT_SIZE)
+        extents_.erase(extent);
+      return page_id;
+    }
+  }
+  if (num_free_pages_ >= EXTENT_SIZE)
+    return TakeFreePage();
+  page_id_t page_id = next_page_id_;
+  next_page_id_ += EXTENT_SIZE;
+  extents_[page_id] = page_id + 1;
+  return page_id;
+}
+
+/**
+ * Private helper: true if page_id cannot hold data yet, because it is beyond
+ * the pages handed out, among the unused pages of an extent, or allocated
+ * but not written since the file was opened
  */
-page_id_t DiskManager::AllocatePage() { return next_page_id_++; }
+bool DiskManager::IsUnwritten(page_id_t page_id) {
+  std::lock_guard<std::mutex> guard(free_latch_);
+  if (page_id >= next_page_id_)
+    return true;
+  auto extent = extents_.upper_bound(page_id);
+  if (extent != extents_.begin()) {
+    --extent;
+    if (page_id >= extent->second && page_id < extent->first + EXTENT_SIZE)
+      return true;
+  }
+  return unwritten_.count(page_id) > 0;
+}
+
+/**
+ * Private helper: the count pages starting at page_id have been written
+ */
+void DiskManager::MarkWritten(page_id_t page_id, size_t count) {
+  if (!checksums_)
+    return;
+  std::lock_guard<std::mutex> guard(free_latch_);
+  for (size_t i = 0; i < count && !unwritten_.empty(); ++i)
+    unwritten_.erase(page_id + i);
+}
+
+/**
+ * Private helper: take the most recently deallocated page from the free list,
+ * or the first trunk itself once it lists no more pages. Caller must hold
+ * free_latch_ and make sure the list is not empty.
+ */
+page_id_t DiskManager::TakeFreePage() {
+  page_id_t page_id;
+  FreeTrunk *trunk = GetTrunk();
+  if (trunk->count_ > 0) {
+    page_id = GetTrunkPages()[--trunk->count_];
+    WriteTrunk();
+  } else {
+    // the next trunk becomes the first one
+    page_id = free_trunk_;
+    free_trunk_ = trunk->next_trunk_;
+    if (free_trunk_ != INVALID_PAGE_ID && !ReadTrunk(free_trunk_)) {
+      LOG_DEBUG("free list trunk %d is damaged", free_trunk_);
+      free_trunk_ = INVALID_PAGE_ID;
+      num_free_pages_ = 1;
+    }
+    WriteMetaBlock();
+  }
+  --num_free_pages_;
+  return page_id;
+}
 
 /**
  * Deallocate page (operations like drop index/table)
- * Need bitmap in header page for tracking pages
+ * The content of the page is lost.
+ */
+void DiskManager::DeallocatePage(page_id_t page_id) {
+  if (IsReadOnly() || page_id < 0 || page_id >= next_page_id_)
+    return;
+  std::lock_guard<std::mutex> guard(free_latch_);
+  FreePage(page_id);
+}
+
+/**
+ * Private helper: add page_id to the first trunk of the free list, when that
+ * one is full the page becomes the first trunk itself. Caller must hold
+ * free_latch_.
+ */
+void DiskManager::FreePage(page_id_t page_id) {
+  if (data_offset_ == 0)
+    return;
+  FreeTrunk *trunk = GetTrunk();
+  if (free_trunk_ != INVALID_PAGE_ID && trunk->count_ < GetTrunkCapacity()) {
+    GetTrunkPages()[trunk->count_++] = page_id;
+    WriteTrunk();
+  } else {
+    trunk_.assign(page_size_, 0);
+    *GetTrunk() = FreeTrunk{FREE_TRUNK_MAGIC, free_trunk_, 0};
+    free_trunk_ = page_id;
+    // the trunk has to be on disk before the meta block points at it,
+    // otherwise a crash in between leaves the list pointing at a stale page
+    WriteTrunk();
+    if (fdatasync(db_fd_) != 0) {
+      LOG_DEBUG("I/O error while syncing free list");
+    }
+    WriteMetaBlock();
+  }
+  ++num_free_pages_;
+}
+
+/**
+ * Private helper for the destructor: give the unused pages of all extents
+ * back. Unused pages have never been written, so the file ends before those
+ * of an extent at its end, and lowering the next page id is enough to take
+ * them back. Extents are not recorded on disk, without this their pages
+ * would be lost.
+ */
+void DiskManager::ReleaseExtents() {
+  std::lock_guard<std::mutex> guard(free_latch_);
+  for (auto extent = extents_.rbegin(); extent != extents_.rend(); ++extent) {
+    page_id_t end = extent->first + EXTENT_SIZE;
+    if (end == next_page_id_) {
+      next_page_id_ = extent->second;
+      continue;
+    }
+    for (page_id_t page_id = extent->second; page_id < end; ++page_id)
+      FreePage(page_id);
+  }
+  extents_.clear();
+}
+
+/**
+ * Returns number of pages that can be read: pages allocated so far or
+ * already present in the db file, whichever is larger
+ */
+page_id_t DiskManager::GetNumPages() {
+  if (IsReadOnly())
+    return num_mapped_pages_;
+  int file_size = GetFileSize(file_name_);
+  page_id_t file_pages =
+      file_size <= static_cast<int>(data_offset_)
+          ? 0
+          : (file_size - data_offset_ + page_size_ - 1) / page_size_;
+  return std::max<page_id_t>(next_page_id_, file_pages);
+}
+
+/**
+ * Returns number of pages in the free list, trunks included
  */
-void DiskManager::DeallocatePage(__attribute__((unused)) page_id_t page_id) {
-  return;
+size_t DiskManager::GetNumFreePages() {
+  std::lock_guard<std::mutex> guard(free_latch_);
+  return num_free_pages_;
 }
 
 /**
@@ -0,0 +1,191 @@
+#include <cassert>
+#include <functional>
+
+#include "hash/linear_probe_hash_table.h"
+#include "page/page.h"
+
+using namespace std;
+namespace cmudb {
+
+/*
+ * constructor
+ * capacity: number of entries allowed, twice as many slots are allocated
+ */
+template <typename K, typename V>
+LinearProbeHashTable<K, V>::LinearProbeHashTable(size_t capacity)
+    : capacity_(capacity), shift_version_(0), size_(0) {
+  size_t slots = 2;
+  while (slots < capacity * 2)
+    slots <<= 1;
+  slots_ = new Slot[slots];
+  mask_ = slots - 1;
+}
+
+template <typename K, typename V>
+LinearProbeHashTable<K, V>::~LinearProbeHashTable() {
+  delete[] slots_;
+}
+
+/*
+ * helper function to calculate the home slot of key, the hash value is mixed
+ * because std::hash is the identity for integers and page ids of one buffer
+ * pool partition share the same remainder
+ */
+template <typename K, typename V>
+size_t LinearProbeHashTable<K, V>::HashKey(const K &key) const {
+  uint64_t h = std::hash<K>()(key);
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  return static_cast<size_t>(h);
+}
+
+/*
+ * helper function to copy a slot without locking, retry until no writer
+ * changed the slot while it was copied
+ */
+template <typename K, typename V>
+void LinearProbeHashTable<K, V>::ReadSlot(Slot &slot, bool &occupied, K &key,
+                                          V &value) const {
+  while (true) {
+    uint32_t version = slot.version.load(memory_order_acquire);
+    if (version & 1)
+      continue;
+    occupied = slot.occupied.load(memory_order_relaxed);
+    key = slot.key.load(memory_order_relaxed);
+    value = slot.value.load(memory_order_relaxed);
+    atomic_thread_fence(memory_order_acquire);
+    if (slot.version.load(memory_order_relaxed) == version)
+      return;
+  }
+}
+
+/*
+ * helper function to update a slot, caller must hold latch_
+ */
+template <typename K, typename V>
+void LinearProbeHashTable<K, V>::WriteSlot(Slot &slot, bool occupied,
+                                           const K &key, const V &value) {
+  uint32_t version = slot.version.load(memory_order_relaxed);
+  slot.version.store(version + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  slot.occupied.store(occupied, memory_order_relaxed);
+  slot.key.store(key, memory_order_relaxed);
+  slot.value.store(value, memory_order_relaxed);
+  slot.version.store(version + 2, memory_order_release);
+}
+
+/*
+ * lookup function to find value associate with input key, never blocks.
+ * The probe is restarted when a removal moved entries meanwhile.
+ */
+template <typename K, typename V>
+bool LinearProbeHashTable<K, V>::Find(const K &key, V &value) {
+  size_t home = HashKey(key) & mask_;
+  while (true) {
+    uint64_t shift_version = shift_version_.load(memory_order_acquire);
+    // entries are being moved, which only takes a few slot writes
+    if (shift_version & 1)
+      continue;
+    bool found = false;
+    V found_value{};
+    size_t index = home;
+    for (size_t probe = 0; probe <= mask_; ++probe) {
+      bool occupied;
+      K slot_key;
+      V slot_value;
+      ReadSlot(slots_[index], occupied, slot_key, slot_value);
+      if (!occupied)
+        break;
+      if (slot_key == key) {
+        found = true;
+        found_value = slot_value;
+        break;
+      }
+      index = (index + 1) & mask_;
+    }
+    atomic_thread_fence(memory_order_acquire);
+    // a shift done meanwhile may have moved the key past the probe
+    if (shift_version_.load(memory_order_relaxed) != shift_version)
+      continue;
+    if (found)
+      value = found_value;
+    return found;
+  }
+}
+
+/*
+ * delete <key,value> entry in hash table. The entries of the cluster behind
+ * it which may live in the gap, those whose home slot does not lie between
+ * the gap and their slot, are shifted back one after the other, so that
+ * every probe still ends at the first empty slot.
+ */
+template <typename K, typename V>
+bool LinearProbeHashTable<K, V>::Remove(const K &key) {
+  lock_guard<mutex> lck(latch_);
+  size_t gap = HashKey(key) & mask_;
+  for (size_t probe = 0;; ++probe) {
+    if (probe > mask_ || !slots_[gap].occupied.load(memory_order_relaxed))
+      return false;
+    if (slots_[gap].key.load(memory_order_relaxed) == key)
+      break;
+    gap = (gap + 1) & mask_;
+  }
+  --size_;
+  // nothing follows, no probe can pass the slot
+  if (!slots_[(gap + 1) & mask_].occupied.load(memory_order_relaxed)) {
+    WriteSlot(slots_[gap], false, K{}, V{});
+    return true;
+  }
+
+  uint64_t shift_version = shift_version_.load(memory_order_relaxed);
+  shift_version_.store(shift_version + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  for (size_t index = (gap + 1) & mask_;
+       slots_[index].occupied.load(memory_order_relaxed);
+       index = (index + 1) & mask_) {
+    K slot_key = slots_[index].key.load(memory_order_relaxed);
+    size_t home = HashKey(slot_key) & mask_;
+    // distance from home at least the distance from the gap: the entry is
+    // reachable from the gap
+    if (((index - home) & mask_) >= ((index - gap) & mask_)) {
+      WriteSlot(slots_[gap], true, slot_key,
+                slots_[index].value.load(memory_order_relaxed));
+      gap = index;
+    }
+  }
+  WriteSlot(slots_[gap], false, K{}, V{});
+  shift_version_.store(shift_version + 2, memory_order_release);
+  return true;
+}
+
+/*
+ * insert <key,value> entry in hash table, or overwrite the value when key
+ * exists
+ */
+template <typename K, typename V>
+void LinearProbeHashTable<K, V>::Insert(const K &key, const V &value) {
+  lock_guard<mutex> lck(latch_);
+  size_t index = HashKey(key) & mask_;
+  while (slots_[index].occupied.load(memory_order_relaxed)) {
+    if (slots_[index].key.load(memory_order_relaxed) == key) {
+      WriteSlot(slots_[index], true, key, value);
+      return;
+    }
+    index = (index + 1) & mask_;
+  }
+  // at most half of the slots are taken, so every probe terminates
+  assert(size_ < capacity_);
+  WriteSlot(slots_[index], true, key, value);
+  ++size_;
+}
+
+template <typename K, typename V> size_t LinearProbeHashTable<K, V>::Size() {
+  lock_guard<mutex> lck(latch_);
+  return size_;
+}
+
+template class LinearProbeHashTable<page_id_t, Page *>;
+// test purpose
+template class LinearProbeHashTable<int, int>;
+} // namespace cmudb
@@ -0,0 +1,89 @@
+/**
+ * arc_replacer.h
+ *
+ * Functionality: Adaptive Replacement Cache (ARC) policy. Resident values live
+ * in one of two lists, T1 for values seen once since they entered the pool
+ * and T2 for values hit again. Two ghost lists, B1 and B2, remember the keys
+ * of values recently evicted from T1 and T2. A miss on a key found in B1
+ * means T1 was too small and grows its target size p, a miss found in B2
+ * shrinks it, so the cache keeps adapting between scan-heavy phases (favour
+ * T2) and lookup-heavy phases (favour T1) without any tuning knob.
+ *
+ * Pinned values stay on their list but are skipped by Victim(). Ghost lists
+ * store GhostKey(value): for buffer frames that is the id of the page the
+ * frame held when it was evicted, since the frame itself gets reused.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "buffer/replacer.h"
+
+namespace cmudb {
+
+// key remembered in the ghost lists once value left the cache
+template <typename T> int64_t GhostKey(const T &value);
+
+template <typename T> class ARCReplacer : public Replacer<T> {
+  enum class ListType { T1 = 0, T2, B1, B2 };
+  struct Entry {
+    ListType list;
+    typename std::list<T>::iterator iter;
+    bool evictable;
+  };
+  struct GhostEntry {
+    ListType list;
+    std::list<int64_t>::iterator iter;
+  };
+
+public:
+  // capacity: number of frames the cache holds
+  explicit ARCReplacer(size_t capacity);
+
+  ~ARCReplacer();
+
+  void Insert(const T &value);
+
+  bool Victim(T &value);
+
+  bool PreferredVictim(T &value,
+                       const std::function<bool(const T &)> &preferred);
+
+  bool Erase(const T &value);
+
+  size_t Size();
+
+  void RecordAccess(const T &value);
+
+  void Remove(const T &value);
+
+  void SetCapacity(size_t capacity);
+
+  void GetRecencyOrder(std::vector<T> &values);
+
+  // target size of T1, exposed for test purpose
+  size_t GetTarget();
+
+private:
+  void Access(const T &value);
+  bool EvictFrom(std::list<T> &list, ListType ghost, T &value,
+                 const std::function<bool(const T &)> *preferred);
+  bool Replace(T &value, const std::function<bool(const T &)> *preferred);
+  void DropGhost(std::list<int64_t> &ghost);
+
+  size_t capacity_;
+  size_t target_; // adaptive target size of T1
+  size_t size_;   // number of evictable values
+  std::list<T> t1_, t2_;
+  std::list<int64_t> b1_, b2_;
+  std::unordered_map<T, Entry> entries_;
+  std::unordered_map<int64_t, GhostEntry> ghosts_;
+  std::mutex latch_;
+};
+
+} // namespace cmudb
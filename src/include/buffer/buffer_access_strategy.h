@@ -0,0 +1,53 @@
+/**
+ * buffer_access_strategy.h
+ *
+ * Functionality: a small private ring of frames for a large sequential scan.
+ * Pages the scan reads through its strategy are loaded into frames of its
+ * ring, and once the ring is full the scan recycles its own frames instead of
+ * evicting pages other threads are working with. Ring pages are kept away
+ * from the replacer of the pool, so a scan neither floods it nor disturbs its
+ * access history.
+ *
+ * A ring page another thread fetches leaves the ring and becomes an ordinary
+ * page of the pool. When the strategy is destroyed the clean pages of the
+ * ring are dropped and their frames freed, dirty ones are handed to the
+ * replacer. The strategy has to be destroyed before its buffer pool manager.
+ */
+
+#pragma once
+
+#include <vector>
+
+namespace cmudb {
+
+class BufferPoolManager;
+class Page;
+
+class BufferAccessStrategy {
+  friend class BufferPoolManager;
+
+  // frames of one partition of the pool, recycled round robin
+  struct Ring {
+    std::vector<Page *> frames_;
+    size_t next_ = 0; // frame to recycle next once the ring is full
+  };
+
+public:
+  // ring_size: number of frames of the whole ring, each partition of the pool
+  // gets its share, but at most a quarter of its frames and at least one
+  BufferAccessStrategy(BufferPoolManager *buffer_pool_manager,
+                       size_t ring_size);
+  ~BufferAccessStrategy();
+  BufferAccessStrategy(const BufferAccessStrategy &) = delete;
+  BufferAccessStrategy &operator=(const BufferAccessStrategy &) = delete;
+
+  // number of frames of the ring in one partition
+  inline size_t GetRingSize() const { return ring_size_; }
+
+private:
+  BufferPoolManager *buffer_pool_manager_;
+  size_t ring_size_;
+  std::vector<Ring> rings_; // one per partition of the pool
+};
+
+} // namespace cmudb
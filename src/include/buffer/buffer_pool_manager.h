@@ -4,44 +4,310 @@
  * Functionality: The simplified Buffer Manager interface allows a client to
  * new/delete pages on disk, to read a disk page into the buffer pool and pin
  * it, also to unpin a page in the buffer pool.
+ *
+ * The pool can be split into several partitions. Each partition owns a slice
+ * of the frames together with its own page table, replacer, free list and
+ * latch, and a page always lives in partition (page_id % num_partitions), so
+ * threads working on different pages rarely contend on the same latch.
+ *
+ * Scans can ask for read-ahead: PrefetchPage() queues a page (and optionally
+ * the pages chained behind it) for a background thread which loads them into
+ * the pool unpinned, so the I/O overlaps with the work of the scan. Queued
+ * single pages are read together as one asynchronous batch. Chains mostly
+ * lie in consecutive pages of one extent, so the pages following the first
+ * one are read along with it in one sequential read, and checked against the
+ * chain afterwards.
+ *
+ * An optional flush thread writes dirty unpinned pages back ahead of time so
+ * that a configurable fraction of the evictable frames stays clean, and
+ * eviction prefers clean victims, which keeps writes off the fetch path.
+ *
+ * A hit on a resident page takes no latch at all: the page is found in the
+ * concurrent page table and pinned with a compare-and-swap on its pin count.
+ * Only misses, read-ahead and ring pages of scans go through the partition
+ * latch, and so does unpinning when the pin count drops to zero. A frame
+ * pinned that way leaves the replacer right after, so that no victim search
+ * drops the access history of a hot page; eviction claims a frame by moving
+ * its pin count from 0 to -1 and skips frames it cannot claim.
+ *
+ * Callers which keep going back to the same pages, like b+ tree traversals,
+ * can remember the frame of a page and hand it to FetchPageHinted(). The
+ * frame is pinned and its page id checked, which skips the page table
+ * altogether; a frame that was reused for another page meanwhile merely
+ * makes the fetch fall back to the page table.
+ *
+ * Hits, misses, evictions, write-backs and latch waits are counted per thread
+ * and summed up by GetStats().
+ *
+ * Large scans pass a BufferAccessStrategy to FetchPage(), their pages then
+ * cycle through a small ring of frames instead of the whole pool.
+ *
+ * Resize() grows or shrinks the pool at runtime. Frames are allocated in
+ * chunks which are spread over the partitions; shrinking evicts unpinned
+ * frames of the newest chunks one partition latch at a time and frees the
+ * memory of a chunk once all its frames are gone. The linear probing page
+ * table of a partition has a fixed capacity, growing past it replaces the
+ * table by one twice the new frame count.
+ *
+ * Misses read the page without holding the partition latch. The frame is
+ * entered into the page table first but stays claimed, so concurrent fetches
+ * of the same page wait for the read to finish (on the io_cv_ of the
+ * partition) while fetches of other pages go on. The flush thread writes
+ * pages back the same way, all pages of a partition in one asynchronous batch
+ * of the DiskManager.
+ *
+ * A page read from disk which fails its checksum (see DiskManager) never
+ * enters the pool: FetchPage() returns nullptr, read-ahead and warm-up skip
+ * it, and the failure is counted in GetStats().
+ *
+ * When every frame of a partition is pinned, FetchPage() and NewPage() queue
+ * up and wait for a frame to be unpinned, for at most FRAME_WAIT_TIMEOUT.
+ * Waiters are served first come first served, and only if that does not help
+ * either nullptr is returned.
+ *
+ * StartWarmup() names a sidecar file listing the pages resident at the last
+ * clean shutdown, hottest first. A background thread reads them back into
+ * free frames, in asynchronous batches sorted by page id, while live traffic
+ * goes on; the destructor writes the list again.
+ *
+ * On a read-only DiskManager the pool has no frames at all: every page of the
+ * mapped file gets a Page pointing into the mapping, fetching only pins it,
+ * and pages cannot be created, deleted or written.
  */
 
 #pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <list>
 #include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
+#include "buffer/arc_replacer.h"
+#include "buffer/buffer_access_strategy.h"
+#include "buffer/buffer_pool_stats.h"
+#include "buffer/clock_replacer.h"
+#include "buffer/lru_k_replacer.h"
 #include "buffer/lru_replacer.h"
+#include "buffer/page_guard.h"
 #include "disk/disk_manager.h"
 #include "hash/extendible_hash.h"
+#include "hash/linear_probe_hash_table.h"
 #include "logging/log_manager.h"
 #include "page/page.h"
 
 namespace cmudb {
+
+// replacement policy used by every partition of the pool
+enum class ReplacerType { LRU = 0, CLOCK, LRU_K, ARC };
+
+// hash table used as page table by every partition of the pool
+enum class PageTableType { EXTENDIBLE_HASH = 0, LINEAR_PROBE };
+
+// reads the id of the next page of a chain (table heap, b+ tree leaves) out
+// of the raw content of a page, used to follow the chain during read-ahead
+typedef page_id_t (*NextPageFn)(const char *page_data);
+
 class BufferPoolManager {
+  friend class BufferAccessStrategy;
+
 public:
   BufferPoolManager(size_t pool_size, DiskManager *disk_manager,
-                          LogManager *log_manager = nullptr);
+                          LogManager *log_manager = nullptr,
+                          size_t num_partitions = 1,
+                          ReplacerType replacer_type = ReplacerType::LRU,
+                          size_t replacer_k = 2,
+                          PageTableType page_table_type =
+                              PageTableType::LINEAR_PROBE);
 
   ~BufferPoolManager();
 
-  Page *FetchPage(page_id_t page_id);
+  Page *FetchPage(page_id_t page_id, BufferAccessStrategy *strategy = nullptr);
+
+  // FetchPage() trying the frame in hint first, hint is updated
+  Page *FetchPageHinted(page_id_t page_id, std::atomic<Page *> &hint);
 
   bool UnpinPage(page_id_t page_id, bool is_dirty);
 
   bool FlushPage(page_id_t page_id);
 
-  Page *NewPage(page_id_t &page_id);
+  size_t FlushAllPages();
+
+  // owner_hint: a page of the same table heap or index, see
+  // DiskManager::AllocatePage()
+  Page *NewPage(page_id_t &page_id, page_id_t owner_hint = INVALID_PAGE_ID);
 
   bool DeletePage(page_id_t page_id);
 
+  // scoped variants of FetchPage() and NewPage(), the guard gives the pin
+  // (and latch) back, the guard is invalid when no frame was available
+  PageGuard FetchPageGuard(page_id_t page_id,
+                           BufferAccessStrategy *strategy = nullptr);
+  ReadPageGuard FetchPageRead(page_id_t page_id,
+                              BufferAccessStrategy *strategy = nullptr);
+  WritePageGuard FetchPageWrite(page_id_t page_id);
+  PageGuard NewPageGuard(page_id_t &page_id,
+                         page_id_t owner_hint = INVALID_PAGE_ID);
+
+  void PrefetchPage(page_id_t page_id, int depth = 1,
+                    NextPageFn next_page = nullptr);
+
+  void RunFlushThread(double clean_target = 0.5);
+  void StopFlushThread();
+
+  void StartWarmup(const std::string &warmup_file);
+
+  size_t Resize(size_t pool_size);
+
+  size_t GetDirtyPageCount();
+  BufferPoolStats GetStats();
+
+  inline size_t GetPoolSize() const { return pool_size_; }
+  inline size_t GetPageSize() const { return page_size_; }
+  // bytes of a page available to table and index pages
+  inline size_t GetUsablePageSize() const {
+    return disk_manager_->GetUsablePageSize();
+  }
+  inline size_t GetNumPartitions() const { return partitions_.size(); }
+  inline ReplacerType GetReplacerType() const { return replacer_type_; }
+  inline PageTableType GetPageTableType() const { return page_table_type_; }
+  inline bool IsMapped() const { return mapped_pages_ != nullptr; }
+
 private:
-  size_t pool_size_; // number of pages in buffer pool
-  Page *pages_;      // array of pages
+  // one queued read-ahead
+  struct PrefetchRequest {
+    page_id_t page_id_;    // first page to load
+    int depth_;            // number of pages of the chain to load
+    NextPageFn next_page_; // how to find the following page
+  };
+
+  struct FrameWaiter;
+
+  // one independent slice of the buffer pool
+  struct Partition {
+    std::vector<Page *> frames_; // frames of slice
+    // to keep track of pages, replaced when Resize() outgrows it
+    std::atomic<HashTable<page_id_t, Page *> *> page_table_;
+    size_t page_table_capacity_; // pages the page table may map
+    // outgrown page tables, latch-free lookups may still read them
+    std::vector<HashTable<page_id_t, Page *> *> retired_page_tables_;
+    Replacer<Page *> *replacer_;   // to find an unpinned page for replacement
+    std::list<Page *> *free_list_; // to find a free page for replacement
+    std::mutex latch_;             // to protect this partition only
+    std::deque<FrameWaiter *> waiters_; // threads waiting for a frame
+    std::condition_variable io_cv_; // a frame finished I/O without the latch
+    inline HashTable<page_id_t, Page *> *PageTable() {
+      return page_table_.load(std::memory_order_acquire);
+    }
+  };
+
+  // a thread queued for a frame of a partition, it leaves the queue when
+  // destroyed, which must happen under the partition latch
+  struct FrameWaiter {
+    ~FrameWaiter() { Leave(); }
+    void Leave();
+    Partition *partition_ = nullptr; // partition queued on, or nullptr
+    std::condition_variable cv_;
+    std::chrono::steady_clock::time_point deadline_;
+  };
+
+  // frames allocated at once, the bookkeeping of retired frames is kept until
+  // destruction because scan rings may still point at it
+  struct FrameChunk {
+    Page *pages_;
+    char *data_;                     // content of all frames of the chunk
+    size_t size_;                    // number of frames
+    size_t live_;                    // number of frames not retired yet
+    std::vector<Partition *> owner_; // partition of each frame, or nullptr
+  };
+
+  inline Partition &GetPartition(page_id_t page_id) {
+    return *partitions_[static_cast<size_t>(page_id) % partitions_.size()];
+  }
+  // the partition a frame belongs to, which only holds pages of its own
+  // while the frame is in use
+  inline Partition &GetFramePartition(Page *page) {
+    return *partitions_[page->partition_];
+  }
+  Replacer<Page *> *CreateReplacer(size_t capacity);
+  HashTable<page_id_t, Page *> *CreatePageTable(size_t capacity);
+  void GrowPageTable(Partition &partition);
+  Page *GetVictimPage(Partition &partition);
+  bool TryPin(Page *page);
+  bool ReleasePin(Partition &partition, Page *page);
+  bool ClaimFrame(Page *page);
+  bool MayTakeFrame(Partition &partition, FrameWaiter &waiter);
+  bool WaitForFrame(Partition &partition, std::unique_lock<std::mutex> &lck,
+                    FrameWaiter &waiter);
+  void NotifyFrameWaiter(Partition &partition);
+  void EvictPage(Partition &partition, Page *page);
+  Page *GetRingVictim(Partition &partition, BufferAccessStrategy *strategy,
+                      page_id_t page_id);
+  void AddToRing(Partition &partition, BufferAccessStrategy *strategy,
+                 page_id_t page_id, Page *page);
+  void ReleaseRingFrame(Partition &partition, BufferAccessStrategy *strategy,
+                        Page *page);
+  void ReleaseStrategy(BufferAccessStrategy *strategy);
+  std::unique_lock<std::mutex> LockPartition(Partition &partition);
+  void NotePinned();
+  void NoteUnpinned();
+  void RunPrefetchThread();
+  page_id_t LoadPage(page_id_t page_id, NextPageFn next_page);
+  page_id_t LoadRun(page_id_t page_id, int depth, NextPageFn next_page,
+                    int &loaded);
+  bool FindPage(Partition &partition, std::unique_lock<std::mutex> &lck,
+                page_id_t page_id, Page *&page);
+  bool ReadFrame(Partition &partition, std::unique_lock<std::mutex> &lck,
+                 Page *page, page_id_t page_id);
+  void DropFrame(Partition &partition, Page *page);
+  bool ReadAhead(Partition &partition, std::unique_lock<std::mutex> &lck,
+                 Page *page, page_id_t page_id);
+  void RunWarmupThread(std::vector<page_id_t> page_ids);
+  size_t ReadAheadBatch(const std::vector<page_id_t> &page_ids,
+                        bool free_frames_only);
+  void SaveWarmupFile();
+  void FlushPartition(Partition &partition);
+  void AddFrames(size_t count);
+  size_t RetireFrames(size_t count);
+  bool RetireFrame(Partition &partition, Page *page);
+  Page *FetchMappedPage(page_id_t page_id);
+  bool UnpinMappedPage(page_id_t page_id);
+
+  std::atomic<size_t> pool_size_; // number of pages in buffer pool
+  size_t page_size_;              // page size of the database file
+  std::vector<FrameChunk> chunks_;
+  std::mutex resize_latch_; // to serialize resizes, protects chunks_
   DiskManager *disk_manager_;
   LogManager *log_manager_;
-  HashTable<page_id_t, Page *> *page_table_; // to keep track of pages
-  Replacer<Page *> *replacer_;   // to find an unpinned page for replacement
-  std::list<Page *> *free_list_; // to find a free page for replacement
-  std::mutex latch_;             // to protect shared data structure
+  ReplacerType replacer_type_;
+  size_t replacer_k_; // K of the LRU-K policy
+  PageTableType page_table_type_;
+  std::vector<Partition *> partitions_;
+  // views of the pages of a read-only database, nullptr otherwise
+  Page *mapped_pages_;
+  page_id_t num_mapped_pages_;
+  // read-ahead, the thread is only started by the first PrefetchPage()
+  std::thread *prefetch_thread_;
+  std::deque<PrefetchRequest> prefetch_queue_;
+  std::mutex prefetch_latch_; // to protect the queue and the thread
+  std::condition_variable prefetch_cv_;
+  bool prefetch_stop_;
+  // write-behind
+  std::thread *flush_thread_;
+  std::mutex flush_latch_; // to protect the thread and its settings
+  std::condition_variable flush_cv_;
+  bool flush_stop_;
+  double clean_target_; // fraction of unpinned frames to keep clean
+  // warm-up
+  std::string warmup_file_; // empty unless StartWarmup() was called
+  std::thread *warmup_thread_;
+  std::atomic<bool> warmup_stop_;
+  // metrics
+  BufferPoolCounters counters_;
+  std::atomic<size_t> pinned_frames_;
+  std::atomic<size_t> pinned_frames_high_water_;
 };
 } // namespace cmudb
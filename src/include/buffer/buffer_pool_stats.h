@@ -0,0 +1,104 @@
+/**
+ * buffer_pool_stats.h
+ *
+ * Functionality: counters of the buffer pool manager. Every thread bumps its
+ * own stripe of relaxed atomic counters, so counting never bounces a cache
+ * line between cores; the stripes are only summed up when a snapshot is
+ * taken.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace cmudb {
+
+enum class BufferPoolCounter {
+  HIT = 0,              // FetchPage found the page in the pool
+  FAST_HIT,             // hits served without the partition latch
+  HINT_HIT,             // hits served from a frame hint, no page table lookup
+  MISS,                 // FetchPage had to read the page
+  EVICTION,             // a resident page was replaced
+  EVICTION_WRITEBACK,   // dirty victim written on the fetch path
+  BACKGROUND_WRITEBACK, // dirty page written by the flush thread
+  FLUSH_WRITEBACK,      // dirty page written by FlushPage/FlushAllPages
+  NEW_PAGE,             // successful NewPage calls
+  DELETE_PAGE,          // successful DeletePage calls
+  LATCH_WAIT,           // partition latch acquisitions that had to wait
+  LATCH_WAIT_NS,        // time spent waiting for partition latches
+  FRAME_WAIT,           // fetches that had to wait for a free frame
+  FRAME_WAIT_FAILURE,   // waits that timed out or found the queue full
+  WARMUP_LOAD,          // pages preloaded from the warm-up file
+  CHECKSUM_FAILURE,     // pages read from disk which failed their checksum
+  NUM_COUNTERS
+};
+
+// snapshot of the counters plus a few gauges
+struct BufferPoolStats {
+  uint64_t hits_ = 0;
+  uint64_t fast_hits_ = 0;
+  uint64_t hint_hits_ = 0;
+  uint64_t misses_ = 0;
+  uint64_t evictions_ = 0;
+  uint64_t eviction_writebacks_ = 0;
+  uint64_t background_writebacks_ = 0;
+  uint64_t flush_writebacks_ = 0;
+  uint64_t new_pages_ = 0;
+  uint64_t deleted_pages_ = 0;
+  uint64_t latch_waits_ = 0;
+  uint64_t latch_wait_ns_ = 0;
+  uint64_t frame_waits_ = 0;
+  uint64_t frame_wait_failures_ = 0;
+  uint64_t warmup_loads_ = 0;
+  uint64_t checksum_failures_ = 0;
+  size_t pool_size_ = 0;
+  size_t pinned_frames_ = 0;            // frames pinned right now
+  size_t pinned_frames_high_water_ = 0; // most frames ever pinned at once
+
+  inline double GetHitRatio() const {
+    return hits_ + misses_ == 0
+               ? 0
+               : static_cast<double>(hits_) / (hits_ + misses_);
+  }
+  std::string ToString() const;
+};
+
+class BufferPoolCounters {
+  static const size_t NUM_STRIPES = 16;
+  static const size_t NUM_COUNTERS =
+      static_cast<size_t>(BufferPoolCounter::NUM_COUNTERS);
+
+  // padded to whole cache lines so that stripes do not share one
+  struct Stripe {
+    std::atomic<uint64_t> values_[NUM_COUNTERS];
+    char padding_[64 - NUM_COUNTERS * sizeof(uint64_t) % 64];
+  };
+
+public:
+  BufferPoolCounters();
+
+  inline void Add(BufferPoolCounter counter, uint64_t delta = 1) {
+    stripes_[GetThreadStripe()]
+        .values_[static_cast<size_t>(counter)]
+        .fetch_add(delta, std::memory_order_relaxed);
+  }
+
+  uint64_t Get(BufferPoolCounter counter) const;
+
+  // fill the counter part of stats
+  void Collect(BufferPoolStats &stats) const;
+
+private:
+  // threads are spread round robin over the stripes
+  static inline size_t GetThreadStripe() {
+    static std::atomic<size_t> next_stripe(0);
+    thread_local size_t stripe = next_stripe++ % NUM_STRIPES;
+    return stripe;
+  }
+
+  Stripe stripes_[NUM_STRIPES];
+};
+
+} // namespace cmudb
@@ -0,0 +1,61 @@
+/**
+ * clock_replacer.h
+ *
+ * Functionality: CLOCK (second chance) replacement policy. Every value owns a
+ * slot in a fixed array that is allocated once at construction, each slot
+ * keeps an evictable flag and a reference bit. Victim() sweeps a clock hand
+ * over the slots: a set reference bit is cleared and the slot skipped once,
+ * the first evictable slot whose bit is already clear is chosen.
+ *
+ * A value keeps its slot after it is erased or evicted, so the same buffer
+ * frames going through pin/unpin cycles never allocate memory.
+ */
+
+#pragma once
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "buffer/replacer.h"
+
+namespace cmudb {
+
+template <typename T> class ClockReplacer : public Replacer<T> {
+  struct Slot {
+    T value{};
+    bool evictable = false; // value is inside the replacer
+    bool reference = false; // second chance bit
+  };
+
+public:
+  // capacity: number of distinct values (buffer frames) expected
+  explicit ClockReplacer(size_t capacity);
+
+  ~ClockReplacer();
+
+  void Insert(const T &value);
+
+  bool Victim(T &value);
+
+  bool PreferredVictim(T &value,
+                       const std::function<bool(const T &)> &preferred);
+
+  bool Erase(const T &value);
+
+  size_t Size();
+
+private:
+  size_t AcquireSlot();
+  bool Sweep(T &value, const std::function<bool(const T &)> *preferred,
+             size_t max_steps);
+
+  std::vector<Slot> slots_;
+  std::unordered_map<T, size_t> slot_of_;
+  size_t hand_;        // position of the clock hand
+  size_t next_unused_; // slots below this index have been handed out
+  size_t size_;        // number of evictable values
+  std::mutex latch_;
+};
+
+} // namespace cmudb
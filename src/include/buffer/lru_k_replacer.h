@@ -0,0 +1,71 @@
+/**
+ * lru_k_replacer.h
+ *
+ * Functionality: LRU-K replacement policy. The replacer remembers the last K
+ * access timestamps of every value and evicts the evictable value whose
+ * backward K-distance (now - timestamp of its K-th most recent access) is the
+ * largest. Values with fewer than K recorded accesses have an infinite
+ * distance and are evicted first, oldest first access first, so pages that a
+ * sequential scan touches once cannot push out pages that are hit repeatedly.
+ *
+ * Accesses are reported through RecordAccess(); Insert() only marks a value
+ * evictable (it records one access for a value the replacer has never seen).
+ * The history survives Erase() and is dropped by Victim() and Remove().
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "buffer/replacer.h"
+
+namespace cmudb {
+
+template <typename T> class LRUKReplacer : public Replacer<T> {
+  struct Entry {
+    std::vector<uint64_t> history; // ring buffer of the last K accesses
+    size_t count = 0;              // total number of recorded accesses
+    bool evictable = false;
+  };
+
+public:
+  explicit LRUKReplacer(size_t k = 2);
+
+  ~LRUKReplacer();
+
+  void Insert(const T &value);
+
+  bool Victim(T &value);
+
+  bool PreferredVictim(T &value,
+                       const std::function<bool(const T &)> &preferred);
+
+  bool Erase(const T &value);
+
+  size_t Size();
+
+  void RecordAccess(const T &value);
+
+  void Remove(const T &value);
+
+  void GetRecencyOrder(std::vector<T> &values);
+
+private:
+  void Access(Entry &entry);
+  // timestamp of the K-th most recent access, or the first one if fewer
+  uint64_t EarliestAccess(const Entry &entry) const;
+  typename std::unordered_map<T, Entry>::iterator
+  FindVictim(const std::function<bool(const T &)> *preferred,
+             bool infinite_only);
+
+  size_t k_;
+  uint64_t current_timestamp_;
+  size_t size_; // number of evictable values
+  std::unordered_map<T, Entry> entries_;
+  std::mutex latch_;
+};
+
+} // namespace cmudb
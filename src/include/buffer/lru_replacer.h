@@ -11,6 +11,7 @@
 
 #include <memory>
 #include <unordered_map>
+#include <vector>
 #include <mutex>
 #include "buffer/replacer.h"
 #include "hash/extendible_hash.h"
@@ -35,10 +36,15 @@ public:
 
   bool Victim(T &value);
 
+  bool PreferredVictim(T &value,
+                       const std::function<bool(const T &)> &preferred);
+
   bool Erase(const T &value);
 
   size_t Size();
 
+  void GetRecencyOrder(std::vector<T> &values);
+
 private:
   // add your member variables here
   std::unordered_map<T, std::shared_ptr<Node>> map_;
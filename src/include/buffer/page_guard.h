@@ -0,0 +1,101 @@
+/**
+ * page_guard.h
+ *
+ * Functionality: scoped handles for pages of the buffer pool. A guard owns one
+ * pin of a page (and the read or write latch for ReadPageGuard and
+ * WritePageGuard) and gives it back exactly once, either by Drop() or when it
+ * goes out of scope. Guards can be moved but not copied, so the ownership of a
+ * pin is always obvious from the code.
+ *
+ * A guard returned for a page the pool could not provide is invalid, test it
+ * with IsValid() before use.
+ */
+
+#pragma once
+
+#include "page/page.h"
+
+namespace cmudb {
+
+class BufferPoolManager;
+
+// owns a pin only, the page is not latched
+class PageGuard {
+public:
+  PageGuard() = default;
+  // take over a pin of page, page may be nullptr
+  PageGuard(BufferPoolManager *buffer_pool_manager, Page *page);
+  PageGuard(PageGuard &&that) noexcept;
+  PageGuard &operator=(PageGuard &&that) noexcept;
+  PageGuard(const PageGuard &) = delete;
+  PageGuard &operator=(const PageGuard &) = delete;
+  ~PageGuard() { Drop(); }
+
+  // unpin the page now, the guard becomes invalid
+  void Drop();
+
+  inline bool IsValid() const { return page_ != nullptr; }
+  inline Page *GetPage() { return page_; }
+  inline page_id_t GetPageId() { return page_->GetPageId(); }
+  inline char *GetData() { return page_->GetData(); }
+  // view of the page content as a page type (b+ tree pages, header page)
+  template <typename T> inline T *As() {
+    return reinterpret_cast<T *>(page_->GetData());
+  }
+  // the page is unpinned as dirty
+  inline void SetDirty() { is_dirty_ = true; }
+
+private:
+  BufferPoolManager *buffer_pool_manager_ = nullptr;
+  Page *page_ = nullptr;
+  bool is_dirty_ = false;
+};
+
+// owns a pin and the read latch of a page
+class ReadPageGuard {
+public:
+  ReadPageGuard() = default;
+  // latch the page pinned by guard
+  explicit ReadPageGuard(PageGuard &&guard);
+  ReadPageGuard(ReadPageGuard &&that) noexcept = default;
+  ReadPageGuard &operator=(ReadPageGuard &&that) noexcept;
+  ~ReadPageGuard() { Drop(); }
+
+  // unlatch and unpin the page now, the guard becomes invalid
+  void Drop();
+
+  inline bool IsValid() const { return guard_.IsValid(); }
+  inline Page *GetPage() { return guard_.GetPage(); }
+  inline page_id_t GetPageId() { return guard_.GetPageId(); }
+  inline char *GetData() { return guard_.GetData(); }
+  template <typename T> inline T *As() { return guard_.As<T>(); }
+
+private:
+  PageGuard guard_;
+};
+
+// owns a pin and the write latch of a page
+class WritePageGuard {
+public:
+  WritePageGuard() = default;
+  // latch the page pinned by guard
+  explicit WritePageGuard(PageGuard &&guard);
+  WritePageGuard(WritePageGuard &&that) noexcept = default;
+  WritePageGuard &operator=(WritePageGuard &&that) noexcept;
+  ~WritePageGuard() { Drop(); }
+
+  // unlatch and unpin the page now, the guard becomes invalid
+  void Drop();
+
+  inline bool IsValid() const { return guard_.IsValid(); }
+  inline Page *GetPage() { return guard_.GetPage(); }
+  inline page_id_t GetPageId() { return guard_.GetPageId(); }
+  inline char *GetData() { return guard_.GetData(); }
+  template <typename T> inline T *As() { return guard_.As<T>(); }
+  inline void SetDirty() { guard_.SetDirty(); }
+
+private:
+  PageGuard guard_;
+};
+
+} // namespace cmudb
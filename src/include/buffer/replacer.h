@@ -6,6 +6,8 @@
 #pragma once
 
 #include <cstdlib>
+#include <functional>
+#include <vector>
 
 namespace cmudb {
 
@@ -17,6 +19,22 @@ public:
   virtual bool Victim(T &value) = 0;
   virtual bool Erase(const T &value) = 0;
   virtual size_t Size() = 0;
+  // policies that rank values by their access history get told about every
+  // access, and about values leaving the pool for good (history is dropped)
+  virtual void RecordAccess(const T &value) {}
+  virtual void Remove(const T &value) { Erase(value); }
+  // policies sized by the number of frames are told when the pool is resized
+  virtual void SetCapacity(size_t capacity) {}
+  // evictable values from the one the policy would keep longest to the next
+  // victim, policies without a full order leave values empty
+  virtual void GetRecencyOrder(std::vector<T> &values) {}
+  // like Victim(), but a value satisfying preferred goes before comparable
+  // ones (the buffer pool prefers clean pages), each policy decides how far
+  // it may deviate from its own order; by default nothing is preferred
+  virtual bool PreferredVictim(T &value,
+                               const std::function<bool(const T &)> &preferred) {
+    return Victim(value);
+  }
 };
 
 } // namespace cmudb
@@ -16,15 +16,33 @@ extern std::chrono::duration<long long int> LOG_TIMEOUT;
 
 extern std::atomic<bool> ENABLE_LOGGING;
 
+extern std::chrono::milliseconds FLUSH_TIMEOUT; // wake up of the page flusher
+
+extern std::chrono::milliseconds FRAME_WAIT_TIMEOUT; // wait for a free frame
+
 #define INVALID_PAGE_ID -1 // representing an invalid page id
 #define INVALID_TXN_ID -1  // representing an invalid txn id
 #define INVALID_LSN -1     // representing an invalid lsn
 #define HEADER_PAGE_ID 0   // the header page id
-#define PAGE_SIZE 512// size of a data page in byte
+#define PAGE_SIZE 512// default size of a data page in byte
+#define MIN_PAGE_SIZE 512              // page size bounds of a database file
+#define MAX_PAGE_SIZE 65536
+#define CHECKSUM_SIZE 4                // page trailer holding a crc32c
 #define LOG_BUFFER_SIZE                                                            \
   ((BUFFER_POOL_SIZE + 1) * PAGE_SIZE) // size of a log buffer in byte
 #define BUCKET_SIZE 50                 // size of extendible hash bucket
 #define BUFFER_POOL_SIZE 10            // size of buffer pool
+#define READ_AHEAD_DEPTH 4             // pages prefetched ahead of a scan
+#define SCAN_RING_SIZE 16              // frames recycled by a full table scan
+#define OPTIMISTIC_READ_RETRIES 8      // optimistic descents before latching
+#define FRAME_WAIT_QUEUE_SIZE 64       // threads waiting for a frame at most
+#define WARMUP_BATCH_SIZE 64           // pages preloaded in one sorted batch
+#define EXTENT_SIZE 64                 // pages reserved at once for one owner
+#define FRAME_HINT_TABLE_SIZE 1024     // frames of its pages a b+ tree remembers
+#define TRACE_RING_SIZE 1024           // trace events kept per thread
+#define TRACE_MAX_ARGS 4               // integer arguments of one trace event
+#define ASYNC_IO_QUEUE_DEPTH 64        // page I/Os in flight at most
+#define ASYNC_IO_THREADS 4             // workers of the io_uring fallback
 
 typedef int32_t page_id_t; // page id type
 typedef int32_t txn_id_t;  // transaction id type
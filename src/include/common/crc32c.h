@@ -0,0 +1,27 @@
+/**
+ * crc32c.h
+ *
+ * CRC-32C (Castagnoli), the checksum of iSCSI, ext4 and most storage engines.
+ * x86-64 processors with SSE4.2 compute it with the crc32 instruction, eight
+ * bytes per instruction; the choice is made once at run time, elsewhere a
+ * table driven version processing eight bytes per step is used. Both give the
+ * same results.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace cmudb {
+
+// checksum of size bytes at data, crc continues an earlier checksum
+uint32_t Crc32c(const char *data, size_t size, uint32_t crc = 0);
+
+// the table driven version, for tests and benchmarks
+uint32_t Crc32cPortable(const char *data, size_t size, uint32_t crc = 0);
+
+// true if Crc32c() uses the crc32 instruction
+bool Crc32cIsAccelerated();
+
+} // namespace cmudb
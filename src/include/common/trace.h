@@ -0,0 +1,113 @@
+/**
+ * trace.h
+ *
+ * Tracing for hot paths (page fetches, latches, b+ tree descents). Unlike the
+ * LOG_XXX macros of logger.h nothing is formatted or written when an event is
+ * recorded: every thread appends the format string and up to TRACE_MAX_ARGS
+ * integer arguments to its own ring of the last TRACE_RING_SIZE events, which
+ * takes no lock and makes no system call. Tracer::Dump() merges the rings of
+ * all threads by time and formats them, e.g. at the end of a failing test or
+ * from a debugger (call cmudb::Tracer::Dump(stderr)).
+ *
+ * The format must be a string literal, it is only stored as a pointer, and
+ * all its conversions must be %lld, the arguments are kept as int64_t.
+ *
+ * Levels are removed at compile time like the LOG_XXX macros, but the
+ * arguments of a removed trace are still compiled, so variables used only by
+ * traces do not become unused. By default debug builds trace at
+ * LOG_LEVEL_DEBUG and release builds not at all, give the TRACE_LEVEL compile
+ * option to change that.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+
+#include "common/config.h"
+#include "common/logger.h"
+
+namespace cmudb {
+
+#ifndef TRACE_LEVEL
+#ifndef NDEBUG
+#define TRACE_LEVEL LOG_LEVEL_DEBUG
+#else
+#define TRACE_LEVEL LOG_LEVEL_OFF
+#endif
+#endif
+
+// one recorded event, a cache line each
+struct TraceEvent {
+  std::atomic<uint64_t> seq_; // position in the ring + 1, 0 while written
+  uint64_t time_ns_;
+  const char *format_;
+  uint32_t thread_; // number of the thread, in order of its first event
+  int32_t level_;
+  int64_t args_[TRACE_MAX_ARGS];
+};
+
+// events of one thread, only the owning thread writes
+struct TraceRing {
+  TraceEvent events_[TRACE_RING_SIZE];
+  std::atomic<uint64_t> next_; // number of events ever recorded
+  uint32_t thread_;            // current owner
+};
+
+class Tracer {
+public:
+  static void Record(int level, const char *format, const int64_t *args,
+                     size_t num_args);
+
+  // write the events of all threads, oldest first, one per line
+  // return the number of events written
+  static size_t Dump(FILE *out);
+
+  // forget all events recorded so far
+  static void Clear();
+
+private:
+  static TraceRing *GetThreadRing();
+};
+
+template <typename... Args>
+inline void Trace(int level, const char *format, Args... args) {
+  const int64_t values[] = {0, static_cast<int64_t>(args)...};
+  Tracer::Record(level, format, values + 1, sizeof...(args));
+}
+
+#if TRACE_LEVEL <= LOG_LEVEL_INFO
+#define TRACE_INFO_ENABLED
+#define TRACE_INFO(...) ::cmudb::Trace(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define TRACE_INFO(...)                                                        \
+  do {                                                                         \
+    if (false)                                                                 \
+      ::cmudb::Trace(LOG_LEVEL_INFO, __VA_ARGS__);                             \
+  } while (0)
+#endif
+
+#if TRACE_LEVEL <= LOG_LEVEL_DEBUG
+#define TRACE_DEBUG_ENABLED
+#define TRACE_DEBUG(...) ::cmudb::Trace(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define TRACE_DEBUG(...)                                                       \
+  do {                                                                         \
+    if (false)                                                                 \
+      ::cmudb::Trace(LOG_LEVEL_DEBUG, __VA_ARGS__);                            \
+  } while (0)
+#endif
+
+#if TRACE_LEVEL <= LOG_LEVEL_TRACE
+#define TRACE_VERBOSE_ENABLED
+#define TRACE_VERBOSE(...) ::cmudb::Trace(LOG_LEVEL_TRACE, __VA_ARGS__)
+#else
+#define TRACE_VERBOSE(...)                                                     \
+  do {                                                                         \
+    if (false)                                                                 \
+      ::cmudb::Trace(LOG_LEVEL_TRACE, __VA_ARGS__);                            \
+  } while (0)
+#endif
+
+} // namespace cmudb
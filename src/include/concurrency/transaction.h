@@ -9,7 +9,9 @@
 #include <memory>
 #include <thread>
 #include <unordered_set>
+#include <utility>
 
+#include "buffer/page_guard.h"
 #include "common/config.h"
 #include "common/logger.h"
 #include "page/page.h"
@@ -56,7 +58,8 @@ public:
         exclusive_lock_set_{new std::unordered_set<RID>} {
     // initialize sets
     write_set_.reset(new std::deque<WriteRecord>);
-    page_set_.reset(new std::deque<Page *>);
+    page_set_.reset(new std::deque<WritePageGuard>);
+    read_page_set_.reset(new std::deque<ReadPageGuard>);
     deleted_page_set_.reset(new std::unordered_set<page_id_t>);
   }
 
@@ -73,11 +76,22 @@ public:
     return write_set_;
   }
 
-  inline std::shared_ptr<std::deque<Page *>> GetPageSet() { return page_set_; }
+  inline std::shared_ptr<std::deque<WritePageGuard>> GetPageSet() {
+    return page_set_;
+  }
+
+  inline std::shared_ptr<std::deque<ReadPageGuard>> GetReadPageSet() {
+    return read_page_set_;
+  }
 
-//  inline void AddIntoPageSet(Page *page) { page_set_->push_back(page); }
   //modified, because parent should unlatch last.
-  inline void AddIntoPageSet(Page *page) { page_set_->push_front(page); }
+  inline void AddIntoPageSet(WritePageGuard &&guard) {
+    page_set_->push_front(std::move(guard));
+  }
+
+  inline void AddIntoPageSet(ReadPageGuard &&guard) {
+    read_page_set_->push_front(std::move(guard));
+  }
 
   inline std::shared_ptr<std::unordered_set<page_id_t>> GetDeletedPageSet() {
     return deleted_page_set_;
@@ -115,8 +129,10 @@ private:
   lsn_t prev_lsn_;
 
   // Below are used by concurrent index
-  // this deque contains page pointer that was latche during index operation
-  std::shared_ptr<std::deque<Page *>> page_set_;
+  // these deques hold the guards of the pages write or read latched during
+  // an index operation, a page is unlatched and unpinned when its guard goes
+  std::shared_ptr<std::deque<WritePageGuard>> page_set_;
+  std::shared_ptr<std::deque<ReadPageGuard>> read_page_set_;
   // this set contains page_id that was deleted during index operation
   std::shared_ptr<std::unordered_set<page_id_t>> deleted_page_set_;
 
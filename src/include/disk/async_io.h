@@ -0,0 +1,130 @@
+/**
+ * async_io.h
+ *
+ * Asynchronous file I/O for the disk manager. Requests are handed to an
+ * engine in batches and complete in the background, their callbacks run on a
+ * thread of the engine. Two engines exist:
+ * - IOUringEngine talks to the kernel through io_uring, a whole batch is
+ *   submitted with one system call and a single thread reaps completions.
+ * - ThreadPoolEngine runs pread()/pwrite() on a few worker threads, for
+ *   kernels (or sandboxes) without io_uring.
+ * AsyncIOEngine::Create() picks io_uring when it can be set up.
+ *
+ * Both engines keep at most queue_depth requests in flight, Submit() blocks
+ * while the queue is full. Callbacks must not submit more I/O to the same
+ * engine, the engine may be waiting for them to make room.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cmudb {
+
+// transfer size bytes at offset, retrying after signals and short transfers
+// return the number of bytes transferred, less than size at end of file or
+// on error
+size_t ReadAt(int fd, char *data, size_t size, size_t offset);
+size_t WriteAt(int fd, const char *data, size_t size, size_t offset);
+
+struct AsyncIORequest {
+  int fd_;
+  bool write_;
+  char *data_;
+  size_t size_;
+  size_t offset_;
+  // called once with false on an I/O error, reads ending at end of file are
+  // filled up with zeros and succeed
+  std::function<void(bool)> done_;
+};
+
+class AsyncIOEngine {
+public:
+  // io_uring if the kernel supports it, a pool of threads otherwise
+  static AsyncIOEngine *Create(size_t queue_depth);
+
+  AsyncIOEngine(size_t queue_depth) : queue_depth_(queue_depth) {}
+  virtual ~AsyncIOEngine() {}
+
+  // start all requests, requests is left empty
+  virtual void Submit(std::vector<AsyncIORequest> &requests) = 0;
+  virtual const char *GetName() const = 0;
+
+  // wait until every request submitted so far has completed
+  void Drain();
+  inline size_t GetQueueDepth() const { return queue_depth_; }
+
+protected:
+  // bookkeeping of requests in flight, shared by the engines
+  void WaitForRoom(std::unique_lock<std::mutex> &lck);
+  void Complete(AsyncIORequest &request, bool ok);
+
+  const size_t queue_depth_;
+  std::mutex latch_;
+  std::condition_variable room_cv_; // a request completed
+  size_t in_flight_ = 0;
+};
+
+class ThreadPoolEngine : public AsyncIOEngine {
+public:
+  ThreadPoolEngine(size_t queue_depth, size_t num_threads);
+  ~ThreadPoolEngine();
+
+  void Submit(std::vector<AsyncIORequest> &requests) override;
+  const char *GetName() const override { return "thread pool"; }
+
+private:
+  void RunWorker();
+
+  std::vector<std::thread> workers_;
+  std::deque<AsyncIORequest> queue_;
+  std::condition_variable queue_cv_;
+  bool stop_ = false;
+};
+
+class IOUringEngine : public AsyncIOEngine {
+public:
+  // use IsReady() to find out whether the kernel let us set up the ring
+  explicit IOUringEngine(size_t queue_depth);
+  ~IOUringEngine();
+
+  inline bool IsReady() const { return ring_fd_ >= 0; }
+  void Submit(std::vector<AsyncIORequest> &requests) override;
+  const char *GetName() const override { return "io_uring"; }
+
+private:
+  void CloseRing();
+  void RunReaper();
+  void PushEntry(const AsyncIORequest *request, uint64_t user_data);
+  bool Enter(unsigned min_complete);
+
+  int ring_fd_ = -1;
+  // shared rings, mapped from the kernel
+  void *sq_ring_ = nullptr;
+  size_t sq_ring_size_ = 0;
+  void *cq_ring_ = nullptr;
+  size_t cq_ring_size_ = 0;
+  void *sqes_ = nullptr;
+  size_t sqes_size_ = 0;
+  unsigned *sq_head_ = nullptr;
+  unsigned *sq_tail_ = nullptr;
+  unsigned *sq_mask_ = nullptr;
+  unsigned *sq_array_ = nullptr;
+  unsigned *cq_head_ = nullptr;
+  unsigned *cq_tail_ = nullptr;
+  unsigned *cq_mask_ = nullptr;
+  void *cqes_ = nullptr;
+  // requests in flight by submission slot, user_data of an entry is its slot
+  std::vector<AsyncIORequest> slots_;
+  std::vector<unsigned> free_slots_;
+  std::thread *reaper_ = nullptr;
+};
+
+} // namespace cmudb
@@ -5,31 +5,141 @@
  * database. It also performs read and write of pages to and from disk, and
  * provides a logical file layer within the context of a database management
  * system.
+ *
+ * The page size is chosen when a database file is created and recorded in a
+ * meta block at the start of the file, pages follow the meta block. Files
+ * written before the meta block existed are read with PAGE_SIZE pages
+ * starting at offset 0.
+ *
+ * Deallocated pages are reused by later allocations. They are kept in a free
+ * list made of trunk pages, which are free pages themselves: the meta block
+ * points at the first trunk, every trunk lists up to a page worth of free
+ * page ids and points at the next trunk. Only the first trunk is cached, so
+ * allocating and deallocating costs one page write, and the meta block is
+ * only rewritten when the first trunk changes. The meta block also records
+ * the next page id to allocate, reopening a database goes on from there.
+ * Files without a meta block cannot keep a free list, their deallocated
+ * pages are lost.
+ *
+ * Table heaps and indexes pass one of their pages as owner hint when they
+ * allocate. Their pages are then carved out of extents of EXTENT_SIZE
+ * consecutive pages, one owner per extent, so that a scan along their page
+ * chain reads the file sequentially. Extents only live in memory: on
+ * destruction their unused pages go back to the free list, after a crash
+ * they are lost.
+ *
+ * Every page ends in a CHECKSUM_SIZE byte trailer holding the CRC-32C of the
+ * rest of the page, seeded with the page id so that a page written to the
+ * wrong place is caught as well. It is computed on a private copy when the
+ * page is written and verified when it is read, a mismatch is counted and
+ * reported to the caller. A page of zeros passes only if it was never
+ * written, e.g. it was allocated but not flushed yet. The meta block carries
+ * a trailer too, a file whose meta block fails it is not opened. Pages of
+ * files written before the trailer existed use the whole page and are not
+ * checked; neither are the pages a read-only database hands out straight
+ * from its mapping.
+ *
+ * Page I/O is positional and keeps no cursor or buffer, so any number of
+ * threads may read and write different pages concurrently.
+ *
+ * Batches of pages can also be read and written asynchronously, e.g. by
+ * prefetching and background flushing, so that dozens of page transfers are
+ * in flight at once instead of one per thread. They go through an
+ * AsyncIOEngine (see async_io.h), which is started on first use.
+ *
+ * A database file which never changes, e.g. on a reporting replica, can be
+ * opened read-only. The file is then mapped into memory and the buffer pool
+ * hands out its pages straight from the mapping, the kernel page cache does
+ * the caching.
  */
 
 #pragma once
 #include <atomic>
 #include <fstream>
+#include <functional>
 #include <future>
+#include <map>
+#include <mutex>
 #include <string>
+#include <unordered_set>
+#include <vector>
 
 #include "common/config.h"
 
 namespace cmudb {
 
+class AsyncIOEngine;
+
 class DiskManager {
 public:
-  DiskManager(const std::string &db_file);
+  // one page transfer of an asynchronous batch
+  struct PageIO {
+    page_id_t page_id_;
+    char *data_; // must stay valid until done_ has been called
+    bool write_;
+    // called on an I/O thread, with false on an I/O error or when a page read
+    // fails its checksum
+    std::function<void(bool)> done_;
+  };
+
+  // page_size: power of two in [MIN_PAGE_SIZE, MAX_PAGE_SIZE], only used
+  // when db_file is created, an existing file keeps its own page size
+  // read_only: map the existing db_file read-only, nothing is ever written
+  DiskManager(const std::string &db_file, size_t page_size = PAGE_SIZE,
+              bool read_only = false);
   ~DiskManager();
 
   void WritePage(page_id_t page_id, const char *page_data);
-  void ReadPage(page_id_t page_id, char *page_data);
+  // return false if the page read fails its checksum
+  bool ReadPage(page_id_t page_id, char *page_data);
+  // read or write count consecutive pages starting at page_id with one
+  // system call, intact (if given) tells for every page read whether it
+  // passed its checksum
+  bool ReadPages(page_id_t page_id, char *const *pages_data, size_t count,
+                 bool *intact = nullptr);
+  void WritePages(page_id_t page_id, const char *const *pages_data,
+                  size_t count);
+  // check the trailer of a page read by other means, a page of zeros passes
+  // only if it was never written
+  bool VerifyPage(page_id_t page_id, const char *page_data);
+  // make the pages written so far durable
+  void Sync();
+
+  // start all transfers of batch without waiting for them, batch is left
+  // empty. done_ callbacks must neither wait for other asynchronous I/O nor
+  // take latches held by threads which do.
+  void SubmitPageIO(std::vector<PageIO> &batch);
+  // start all transfers of batch and wait until they are done
+  // return false if any of them failed
+  bool RunPageIO(std::vector<PageIO> &batch);
+  std::future<bool> ReadPageAsync(page_id_t page_id, char *page_data);
+  std::future<bool> WritePageAsync(page_id_t page_id, const char *page_data);
+  // wait until all asynchronous transfers started so far are done
+  void WaitForPageIO();
 
   void WriteLog(char *log_data, int size);
   bool ReadLog(char *log_data, int size, int offset);
 
-  page_id_t AllocatePage();
+  // owner_hint: a page of the table heap or index the new page is for
+  page_id_t AllocatePage(page_id_t owner_hint = INVALID_PAGE_ID);
+  // page_id must be allocated and must not be used any more, every page may
+  // be deallocated only once
   void DeallocatePage(page_id_t page_id);
+  page_id_t GetNumPages();
+  // number of deallocated pages waiting to be reused
+  size_t GetNumFreePages();
+  inline size_t GetPageSize() const { return page_size_; }
+  // bytes of a page available to its content, the trailer excluded
+  inline size_t GetUsablePageSize() const {
+    return checksums_ ? page_size_ - CHECKSUM_SIZE : page_size_;
+  }
+  // number of pages read so far which failed their checksum
+  inline size_t GetNumChecksumFailures() const {
+    return num_checksum_failures_.load();
+  }
+  inline bool IsReadOnly() const { return mapping_ != nullptr; }
+  // content of page_id inside the mapping of a read-only file, or nullptr
+  const char *GetMappedPage(page_id_t page_id) const;
 
   int GetNumFlushes() const;
   bool GetFlushState() const;
@@ -37,14 +147,80 @@ public:
   inline bool HasFlushLogFuture() { return flush_log_f_ != nullptr; }
 
 private:
+  // layout of the meta block at file offset 0, the fields after page_size_
+  // are only present since version 2. Since version 3 pages have checksums,
+  // and so does the meta block, which then fills the whole first page
+  struct MetaBlock {
+    uint32_t magic_;
+    uint32_t version_;
+    uint32_t page_size_;
+    page_id_t next_page_id_;
+    page_id_t free_trunk_; // first trunk page of the free list
+  };
+  // layout of the start of a trunk page, the free page ids follow
+  struct FreeTrunk {
+    uint32_t magic_;
+    page_id_t next_trunk_;
+    uint32_t count_;
+  };
+
   int GetFileSize(const std::string &name);
+  void OpenMetaBlock(size_t page_size);
+  void WriteMetaBlock();
+  void OpenFreeList(page_id_t free_trunk);
+  bool ReadTrunk(page_id_t page_id);
+  void WriteTrunk();
+  page_id_t TakeFreePage();
+  void FreePage(page_id_t page_id);
+  page_id_t AllocateFromExtent(page_id_t owner_hint);
+  void ReleaseExtents();
+  bool ReadMetaChecksum();
+  void StampPage(page_id_t page_id, char *page_data) const;
+  bool ChecksumMatches(page_id_t page_id, const char *page_data) const;
+  bool IsUnwritten(page_id_t page_id);
+  void MarkWritten(page_id_t page_id, size_t count);
+  inline FreeTrunk *GetTrunk() {
+    return reinterpret_cast<FreeTrunk *>(trunk_.data());
+  }
+  inline page_id_t *GetTrunkPages() {
+    return reinterpret_cast<page_id_t *>(trunk_.data() + sizeof(FreeTrunk));
+  }
+  inline size_t GetTrunkCapacity() const {
+    return (GetUsablePageSize() - sizeof(FreeTrunk)) / sizeof(page_id_t);
+  }
+  void MapFile();
+  AsyncIOEngine *GetAsyncIO();
+  inline size_t GetPageOffset(page_id_t page_id) const {
+    return data_offset_ + static_cast<size_t>(page_id) * page_size_;
+  }
   // stream to write log file
   std::fstream log_io_;
   std::string log_name_;
-  // stream to write db file
-  std::fstream db_io_;
+  // descriptor of the db file, pages are read and written with pread() and
+  // pwrite(), so threads can do I/O on different pages at the same time
+  int db_fd_;
   std::string file_name_;
+  size_t page_size_;
+  size_t data_offset_; // file offset of page 0
+  bool checksums_;     // pages end in a checksum trailer
+  std::atomic<size_t> num_checksum_failures_;
   std::atomic<page_id_t> next_page_id_;
+  // free list, protects the meta block as well
+  std::mutex free_latch_;
+  page_id_t free_trunk_;     // first trunk, or INVALID_PAGE_ID
+  std::vector<char> trunk_;  // content of the first trunk
+  size_t num_free_pages_;
+  // extents with unused pages: first page -> next unused page
+  std::map<page_id_t, page_id_t> extents_;
+  // pages allocated since the file was opened and not written yet
+  std::unordered_set<page_id_t> unwritten_;
+  // read-only mapping of the db file
+  char *mapping_;
+  size_t mapping_size_;
+  page_id_t num_mapped_pages_;
+  // engine of asynchronous page I/O, created by the first batch
+  std::once_flag async_io_once_;
+  std::atomic<AsyncIOEngine *> async_io_;
   int num_flushes_;
   bool flush_log_;
   std::future<void> *flush_log_f_;
@@ -0,0 +1,70 @@
+/**
+ * linear_probe_hash_table.h
+ *
+ * Functionality: open addressing hash table with linear probing and a fixed
+ * number of slots, sized once from the number of entries it may hold (the
+ * buffer pool uses the frame count of a partition, a page table never maps
+ * more pages than there are frames) so that it is never more than half full.
+ * The table does not grow, inserting more than capacity entries is an error.
+ *
+ * Find() is lock-free: every slot is guarded by a sequence counter which is
+ * odd while a writer updates the slot, readers copy the slot and retry when
+ * the counter moved underneath them. Insert() and Remove() are serialized by
+ * one mutex. Remove() leaves no tombstones: the entries behind the removed
+ * one are shifted back into the gap, which readers detect through a
+ * table-wide sequence counter and restart their probe.
+ *
+ * K and V have to be trivially copyable (page ids, frame pointers, ...).
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+#include "hash/hash_table.h"
+
+namespace cmudb {
+
+template <typename K, typename V>
+class LinearProbeHashTable : public HashTable<K, V> {
+  struct Slot {
+    std::atomic<uint32_t> version{0}; // odd while a writer updates the slot
+    std::atomic<bool> occupied{false};
+    std::atomic<K> key{};
+    std::atomic<V> value{};
+  };
+
+public:
+  // capacity: number of entries the table may hold
+  explicit LinearProbeHashTable(size_t capacity);
+
+  ~LinearProbeHashTable();
+
+  // lookup and modifier
+  bool Find(const K &key, V &value) override;
+  bool Remove(const K &key) override;
+  void Insert(const K &key, const V &value) override;
+
+  // number of live entries
+  size_t Size();
+  // number of entries the table may hold
+  inline size_t GetCapacity() const { return capacity_; }
+  // number of slots
+  inline size_t GetNumSlots() const { return mask_ + 1; }
+
+private:
+  size_t HashKey(const K &key) const;
+  void ReadSlot(Slot &slot, bool &occupied, K &key, V &value) const;
+  void WriteSlot(Slot &slot, bool occupied, const K &key, const V &value);
+
+  Slot *slots_;
+  size_t mask_;     // number of slots - 1, the slot count is a power of two
+  size_t capacity_; // entries allowed
+  std::atomic<uint64_t> shift_version_; // odd while entries are moved
+  size_t size_;                         // number of occupied slots
+  std::mutex latch_;                    // serializes writers
+};
+
+} // namespace cmudb
@@ -10,6 +10,8 @@
  */
 #pragma once
 
+#include <atomic>
+#include <mutex>
 #include <queue>
 #include <vector>
 
@@ -70,6 +72,12 @@ public:
                                            bool leftMost = false);
 
 private:
+  // FetchPage() through the frame hint of page_id
+  Page *FetchHintedPage(page_id_t page_id);
+
+  bool OptimisticGetValue(const KeyType &key, ValueType &value, bool &found,
+                          char *buffer);
+
   B_PLUS_TREE_LEAF_PAGE_TYPE *TraverseTree(const KeyType &key,
                                            bool leafMost,
 										   OpType optype,
@@ -81,7 +89,7 @@ private:
 								   bool is_exclusive,
 								   Transaction *transaction);
 
-  void FreePages(bool is_exclusive, Transaction *transaction);
+  void FreePages(Transaction *transaction);
 
   template <typename N> N *FetchSiblingPage(const page_id_t &page_id,
                                             Transaction *transaction);
@@ -95,7 +103,7 @@ private:
                         BPlusTreePage *new_node,
                         Transaction *transaction = nullptr);
 
-  template <typename N> N *Split(N *node);
+  template <typename N> N *Split(N *node, PageGuard &new_page);
 
   template <typename N>
   bool CoalesceOrRedistribute(N *node, Transaction *transaction = nullptr);
@@ -117,6 +125,13 @@ private:
   page_id_t root_page_id_;
   BufferPoolManager *buffer_pool_manager_;
   KeyComparator comparator_;
+  // frames the tree last found its pages in, indexed by page id modulo the
+  // table size, so traversals can skip the page table of the buffer pool
+  std::atomic<Page *> frame_hints_[FRAME_HINT_TABLE_SIZE];
+  // emptied pages a reader still had pinned, deleted by a later operation
+  std::mutex deferred_latch_;
+  std::vector<page_id_t> deferred_pages_;
+  std::atomic<size_t> num_deferred_pages_;
 };
 
 } // namespace cmudb
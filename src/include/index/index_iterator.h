@@ -3,6 +3,7 @@
  * For range scan of b+ tree
  */
 #pragma once
+#include "common/trace.h"
 #include "page/b_plus_tree_leaf_page.h"
 
 namespace cmudb {
@@ -28,7 +29,7 @@ public:
   IndexIterator &operator++() {
     //std::cout << "index=" << index_ << " GetSize()= " << item_->GetSize() << std::endl;
     if (index_ == item_->GetSize()-1) {
-	  std::cout << "prev_page_id= " << cur_page_->GetPageId() << std::endl;
+	  TRACE_VERBOSE("IndexIterator leaves page %lld", cur_page_->GetPageId());
 	  auto next_page_id = item_->GetNextPageId();
 	  UnlockAndUnPin();
 	  if (next_page_id == INVALID_PAGE_ID) 
@@ -38,6 +39,7 @@ public:
 		cur_page_->RLatch();
 		item_ = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE*>(cur_page_->GetData());
 		index_ = 0;
+		Prefetch();
 	  }
 	} else 
 	    ++index_;
@@ -51,6 +53,17 @@ private:
   B_PLUS_TREE_LEAF_PAGE_TYPE *item_;
   BufferPoolManager *buffer_pool_manager_;
 
+  // read-ahead of the leaves behind the current one
+  void Prefetch() {
+    buffer_pool_manager_->PrefetchPage(item_->GetNextPageId(), READ_AHEAD_DEPTH,
+                                       &NextLeafPageId);
+  }
+
+  static page_id_t NextLeafPageId(const char *page_data) {
+    return reinterpret_cast<const B_PLUS_TREE_LEAF_PAGE_TYPE *>(page_data)
+        ->GetNextPageId();
+  }
+
   void UnlockAndUnPin() {
     cur_page_->RUnlatch();   
 	buffer_pool_manager_->UnpinPage(cur_page_->GetPageId(), false);
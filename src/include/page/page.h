@@ -4,10 +4,17 @@
  * Wrapper around actual data page in main memory and also contains bookkeeping
  * information used by buffer pool manager like pin_count/dirty_flag/page_id.
  * Use page as a basic unit within the database system
+ * The page content lives in memory handed out by the buffer pool manager,
+ * its size is the page size of the database file.
+ *
+ * The bookkeeping is atomic because a buffer pool hit pins the page without
+ * any latch. A pin count of -1 marks a frame the buffer pool has claimed to
+ * evict or reload it, such a frame cannot be pinned.
  */
 
 #pragma once
 
+#include <atomic>
 #include <cstring>
 #include <iostream>
 
@@ -16,36 +23,69 @@
 
 namespace cmudb {
 
+class BufferAccessStrategy;
+
 class Page {
   friend class BufferPoolManager;
 
 public:
-  Page() { ResetMemory(); }
+  Page() {}
   ~Page(){};
   // get actual data page content
   inline char *GetData() { return data_; }
+  // get size of page content
+  inline size_t GetPageSize() { return page_size_; }
   // get page id
   inline page_id_t GetPageId() { return page_id_; }
   // get page pin count
   inline int GetPinCount() { return pin_count_; }
-  // method use to latch/unlatch page content
-  inline void WUnlatch() { rwlatch_.WUnlock(); }
-  inline void WLatch() { rwlatch_.WLock(); }
+  // method use to latch/unlatch page content, a writer moves version_ to an
+  // odd value while it holds the latch and back to an even one on release
+  inline void WUnlatch() {
+    version_.store(version_.load(std::memory_order_relaxed) + 1,
+                   std::memory_order_release);
+    rwlatch_.WUnlock();
+  }
+  inline void WLatch() {
+    rwlatch_.WLock();
+    version_.store(version_.load(std::memory_order_relaxed) + 1,
+                   std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+  }
   inline void RUnlatch() { rwlatch_.RUnlock(); }
   inline void RLatch() { rwlatch_.RLock(); }
+  // optimistic latching: read the version before reading page content
+  // without any latch, the content is only valid when the version was even
+  // and Validate() still sees the same version afterwards
+  inline uint64_t ReadVersion() {
+    return version_.load(std::memory_order_acquire);
+  }
+  inline bool Validate(uint64_t version) {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return (version & 1) == 0 &&
+           version_.load(std::memory_order_relaxed) == version;
+  }
 
   inline lsn_t GetLSN() { return *reinterpret_cast<lsn_t *>(GetData() + 4); }
   inline void SetLSN(lsn_t lsn) { memcpy(GetData() + 4, &lsn, 4); }
 
 private:
   // method used by buffer pool manager
-  inline void ResetMemory() { memset(data_, 0, PAGE_SIZE); }
+  inline void ResetMemory() { memset(data_, 0, page_size_); }
   // members
-  char data_[PAGE_SIZE]; // actual data
-  page_id_t page_id_ = INVALID_PAGE_ID;
-  int pin_count_ = 0;
-  bool is_dirty_ = false;
+  char *data_ = nullptr; // actual data
+  size_t page_size_ = 0;
+  std::atomic<page_id_t> page_id_{INVALID_PAGE_ID};
+  std::atomic<int> pin_count_{0};
+  std::atomic<bool> is_dirty_{false};
+  // loaded by read-ahead and not fetched since
+  std::atomic<bool> prefetched_{false};
+  // scan ring holding the frame
+  std::atomic<BufferAccessStrategy *> strategy_{nullptr};
+  // partition of the buffer pool owning the frame
+  size_t partition_ = 0;
   RWMutex rwlatch_;
+  std::atomic<uint64_t> version_{0}; // odd while the page is write latched
 };
 
 } // namespace cmudb
@@ -40,6 +40,8 @@ public:
   page_id_t GetPageId();
   page_id_t GetPrevPageId();
   page_id_t GetNextPageId();
+  // next page id read from raw page content, used for read-ahead
+  static page_id_t GetNextPageId(const char *page_data);
   void SetPrevPageId(page_id_t prev_page_id);
   void SetNextPageId(page_id_t next_page_id);
 
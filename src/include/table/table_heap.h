@@ -42,16 +42,23 @@ public:
                    Transaction *txn); // when commit delete or rollback insert
   void RollbackDelete(const RID &rid, Transaction *txn); // when rollback delete
 
-  bool GetTuple(const RID &rid, Tuple &tuple, Transaction *txn);
+  // strategy: scans read the page through their ring of frames
+  bool GetTuple(const RID &rid, Tuple &tuple, Transaction *txn,
+                BufferAccessStrategy *strategy = nullptr);
 
   bool DeleteTableHeap();
 
-  TableIterator begin(Transaction *txn);
+  TableIterator begin(Transaction *txn,
+                      BufferAccessStrategy *strategy = nullptr);
 
   TableIterator end();
 
   inline page_id_t GetFirstPageId() const { return first_page_id_; }
 
+  inline BufferPoolManager *GetBufferPoolManager() const {
+    return buffer_pool_manager_;
+  }
+
 private:
   /**
    * Members
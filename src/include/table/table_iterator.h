@@ -13,13 +13,16 @@
 
 namespace cmudb {
 
+class BufferAccessStrategy;
 class TableHeap;
 
 class TableIterator {
   friend class Cursor;
 
 public:
-  TableIterator(TableHeap *table_heap, RID rid, Transaction *txn);
+  // strategy: ring of frames the pages of the scan are read into
+  TableIterator(TableHeap *table_heap, RID rid, Transaction *txn,
+                BufferAccessStrategy *strategy = nullptr);
 
   ~TableIterator() { delete tuple_; }
 
@@ -43,6 +46,7 @@ private:
   TableHeap *table_heap_;
   Tuple *tuple_;
   Transaction *txn_;
+  BufferAccessStrategy *strategy_;
 };
 
 } // namespace cmudb
\ No newline at end of file
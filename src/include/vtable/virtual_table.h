@@ -62,11 +62,12 @@ int VtabBegin(sqlite3_vtab *pVTab);
 // storage engine
 class StorageEngine {
 public:
-  StorageEngine(std::string db_file_name) {
+  // read_only: serve an unchanging db file straight from a read-only mapping
+  StorageEngine(std::string db_file_name, bool read_only = false) {
     ENABLE_LOGGING = false;
 
     // storage related
-    disk_manager_ = new DiskManager(db_file_name);
+    disk_manager_ = new DiskManager(db_file_name, PAGE_SIZE, read_only);
 
     // log related
     log_manager_ = new LogManager(disk_manager_);
@@ -82,8 +83,9 @@ public:
   ~StorageEngine() {
     if (ENABLE_LOGGING)
       log_manager_->StopFlushThread();
-    delete disk_manager_;
+    buffer_pool_manager_->FlushAllPages();
     delete buffer_pool_manager_;
+    delete disk_manager_;
     delete log_manager_;
     delete lock_manager_;
     delete transaction_manager_;
@@ -172,7 +174,9 @@ public:
     return table_heap_->UpdateTuple(tuple, rid, GetTransaction());
   }
 
-  inline TableIterator begin() { return table_heap_->begin(GetTransaction()); }
+  inline TableIterator begin(BufferAccessStrategy *strategy = nullptr) {
+    return table_heap_->begin(GetTransaction(), strategy);
+  }
 
   inline TableIterator end() { return table_heap_->end(); }
 
@@ -197,8 +201,10 @@ private:
 class Cursor {
 public:
   Cursor(VirtualTable *virtual_table)
-      : table_iterator_(virtual_table->begin()), virtual_table_(virtual_table) {
-  }
+      : strategy_(virtual_table->GetTableHeap()->GetBufferPoolManager(),
+                  SCAN_RING_SIZE),
+        table_iterator_(virtual_table->begin(&strategy_)),
+        virtual_table_(virtual_table) {}
 
   inline void SetScanFlag(bool is_index_scan) {
     is_index_scan_ = is_index_scan;
@@ -257,7 +263,9 @@ private:
   // for index scan
   std::vector<RID> results;
   int offset_ = 0;
-  // for sequential scan
+  // for sequential scan, its pages cycle through a ring of frames so that a
+  // full scan does not push everything else out of the buffer pool
+  BufferAccessStrategy strategy_;
   TableIterator table_iterator_;
   // flag to indicate which scan method is currently used
   bool is_index_scan_ = false;
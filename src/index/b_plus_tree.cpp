@@ -3,10 +3,13 @@
  */
 #include <iostream>
 #include <string>
+#include <thread>
+#include <utility>
 
 #include "common/exception.h"
 #include "common/logger.h"
 #include "common/rid.h"
+#include "common/trace.h"
 #include "index/b_plus_tree.h"
 #include "page/header_page.h"
 
@@ -18,7 +21,11 @@ BPLUSTREE_TYPE::BPlusTree(const std::string &name,
                                 const KeyComparator &comparator,
                                 page_id_t root_page_id)
     : index_name_(name), root_page_id_(root_page_id),
-      buffer_pool_manager_(buffer_pool_manager), comparator_(comparator) {}
+      buffer_pool_manager_(buffer_pool_manager), comparator_(comparator),
+      num_deferred_pages_(0) {
+  for (auto &hint : frame_hints_)
+    hint.store(nullptr, std::memory_order_relaxed);
+}
 
 /*
  * Helper function to decide whether current b+tree is empty
@@ -28,6 +35,18 @@ bool BPLUSTREE_TYPE::IsEmpty() const { return root_page_id_ == INVALID_PAGE_ID;
 /*****************************************************************************
  * SEARCH
  *****************************************************************************/
+/*
+ * Pin page_id, trying the frame it was last found in first. Hints are never
+ * invalidated, the buffer pool checks the page id of the frame before using
+ * it, so a page evicted meanwhile only costs a normal fetch.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+Page *BPLUSTREE_TYPE::FetchHintedPage(page_id_t page_id) {
+  return buffer_pool_manager_->FetchPageHinted(
+      page_id, frame_hints_[static_cast<size_t>(page_id) %
+                            FRAME_HINT_TABLE_SIZE]);
+}
+
 /*
  * Return the only value that associated with input key
  * This method is used for point query
@@ -37,17 +56,81 @@ INDEX_TEMPLATE_ARGUMENTS
 bool BPLUSTREE_TYPE::GetValue(const KeyType &key,
                               std::vector<ValueType> &result,
                               Transaction *transaction) {
-  std::cout << "GetValue() "<< transaction->GetThreadId() << std::endl;
+  TRACE_DEBUG("GetValue()");
+  // readers do not latch at all unless writers keep getting in the way
+  thread_local std::vector<char> buffer;
+  buffer.resize(buffer_pool_manager_->GetPageSize());
+  for (int attempt = 0; attempt < OPTIMISTIC_READ_RETRIES; ++attempt) {
+    ValueType value;
+    bool found;
+    if (OptimisticGetValue(key, value, found, buffer.data())) {
+      if (found) {
+        result.resize(1);
+        result[0] = value;
+      }
+      return found;
+    }
+    std::this_thread::yield();
+  }
   auto leaf_page_ptr = FindLeafPage(key, OpType::SEARCH, transaction, false);  
 //  std::cout << "GetValue: page_id=" << leaf_page_ptr->GetPageId() << std::endl;
   if (leaf_page_ptr == nullptr) return false;
   result.resize(1);
   auto res = leaf_page_ptr->Lookup(key, result[0], comparator_);
-  FreePages(false, transaction);
+  FreePages(transaction);
 //  buffer_pool_manager_->UnpinPage(leaf_page_ptr->GetPageId(), false);
   return res;
 }
 
+/*
+ * Optimistic lookup of key, no page on the way from the root to the leaf is
+ * latched. Every page is pinned, copied into buffer and the copy is only used
+ * once the page version proved that no writer touched the page meanwhile.
+ * The parent is validated again after the version of the child was read, so
+ * a child that was split or merged away in between is noticed as well.
+ * @return : false when a writer got in the way and the lookup has to be
+ * retried, otherwise found tells whether key exists
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::OptimisticGetValue(const KeyType &key, ValueType &value,
+                                        bool &found, char *buffer) {
+  page_id_t page_id = root_page_id_;
+  if (page_id == INVALID_PAGE_ID) {
+    found = false;
+    return true;
+  }
+  PageGuard guard(buffer_pool_manager_, FetchHintedPage(page_id));
+  if (!guard.IsValid())
+    return false;
+  uint64_t version = guard.GetPage()->ReadVersion();
+  // the root may have been split before its version was read
+  if (page_id != root_page_id_)
+    return false;
+  while (true) {
+    Page *page = guard.GetPage();
+    memcpy(buffer, page->GetData(), page->GetPageSize());
+    if (!page->Validate(version))
+      return false;
+    auto node = reinterpret_cast<BPlusTreePage *>(buffer);
+    if (node->IsLeafPage()) {
+      found = static_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(node)->Lookup(
+          key, value, comparator_);
+      return true;
+    }
+    page_id_t child_id =
+        static_cast<B_PLUS_TREE_INTERNAL_PAGE *>(node)->Lookup(key,
+                                                               comparator_);
+    PageGuard child_guard(buffer_pool_manager_, FetchHintedPage(child_id));
+    if (!child_guard.IsValid())
+      return false;
+    uint64_t child_version = child_guard.GetPage()->ReadVersion();
+    if (!page->Validate(version))
+      return false;
+    guard = std::move(child_guard);
+    version = child_version;
+  }
+}
+
 /*****************************************************************************
  * INSERTION
  *****************************************************************************/
@@ -61,7 +144,7 @@ bool BPLUSTREE_TYPE::GetValue(const KeyType &key,
 INDEX_TEMPLATE_ARGUMENTS
 bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value,
                             Transaction *transaction) {
-  std::cout << "Insert() "<< transaction->GetThreadId() << std::endl;
+  TRACE_DEBUG("Insert()");
   if (IsEmpty()) {
     StartNewTree(key, value);
 	return true;
@@ -77,20 +160,20 @@ bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value,
  */
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::StartNewTree(const KeyType &key, const ValueType &value) {
-  std::cout << "StartNewTree() " << std::endl;
+  TRACE_DEBUG("StartNewTree()");
   page_id_t page_id;
-  auto page_ptr = buffer_pool_manager_->NewPage(page_id);
-  assert(page_ptr != nullptr); 
+  auto guard = buffer_pool_manager_->NewPageGuard(page_id);
+  assert(guard.IsValid()); 
   //cast new page to leaf_page.
-  B_PLUS_TREE_LEAF_PAGE_TYPE *root = 
-    reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE*>(page_ptr->GetData());
+  B_PLUS_TREE_LEAF_PAGE_TYPE *root = guard.As<B_PLUS_TREE_LEAF_PAGE_TYPE>();
   //bug: forget to init it.
-  root->Init(page_id, INVALID_PAGE_ID);
+  root->Init(page_id, INVALID_PAGE_ID, buffer_pool_manager_->GetUsablePageSize());
   //insert entry.
   root->Insert(key, value, comparator_);
 
   //unpin page
-  buffer_pool_manager_->UnpinPage(page_id, true);
+  guard.SetDirty();
+  guard.Drop();
   //update root_page_id_.
   root_page_id_ = page_id;
 }
@@ -105,26 +188,25 @@ void BPLUSTREE_TYPE::StartNewTree(const KeyType &key, const ValueType &value) {
 INDEX_TEMPLATE_ARGUMENTS
 bool BPLUSTREE_TYPE::InsertIntoLeaf(const KeyType &key, const ValueType &value,
                                     Transaction *transaction) {
-  std::cout << "InsertIntoLeaf() " << transaction->GetThreadId()<< std::endl;
-  bool is_exclusive;
-  auto leaf_page_ptr = FindLeafPage(key, OpType::INSERT, transaction, false, &is_exclusive);
+  TRACE_DEBUG("InsertIntoLeaf()");
+  auto leaf_page_ptr = FindLeafPage(key, OpType::INSERT, transaction, false);
   if (leaf_page_ptr == nullptr) return false;
   ValueType v;
   auto is_already_exist = leaf_page_ptr->Lookup(key, v, comparator_);
   if (is_already_exist) {
-    FreePages(is_exclusive, transaction);
+    FreePages(transaction);
 //    buffer_pool_manager_->UnpinPage(leaf_page_ptr->GetPageId(), false);
 	return false;
   }
   leaf_page_ptr->Insert(key, value, comparator_);
   if (leaf_page_ptr->GetSize() > leaf_page_ptr->GetMaxSize()) {
-    auto new_leaf_page_ptr = Split(leaf_page_ptr);
+    PageGuard new_leaf_guard;
+    auto new_leaf_page_ptr = Split(leaf_page_ptr, new_leaf_guard);
 	InsertIntoParent(leaf_page_ptr, new_leaf_page_ptr->KeyAt(0), 
 	                 new_leaf_page_ptr, transaction);
-    buffer_pool_manager_->UnpinPage(new_leaf_page_ptr->GetPageId(), true);
   }
 //  buffer_pool_manager_->UnpinPage(leaf_page_ptr->GetPageId(), true);
-  FreePages(true, transaction);
+  FreePages(transaction);
   return true;
 }
 
@@ -134,20 +216,26 @@ bool BPLUSTREE_TYPE::InsertIntoLeaf(const KeyType &key, const ValueType &value,
  * User needs to first ask for new page from buffer pool manager(NOTICE: throw
  * an "out of memory" exception if returned value is nullptr), then move half
  * of key & value pairs from input page to newly created page
+ * new_page keeps the newly created page pinned (and dirty) for the caller
  */
 INDEX_TEMPLATE_ARGUMENTS
-template <typename N> N *BPLUSTREE_TYPE::Split(N *node) { 
+template <typename N> N *BPLUSTREE_TYPE::Split(N *node, PageGuard &new_page) { 
   //1. ask for new page and cast to N
-  std::cout << "Split() " << std::endl;
+  TRACE_DEBUG("Split() page %lld", node->GetPageId());
   page_id_t new_page_id;
-  auto new_page = buffer_pool_manager_->NewPage(new_page_id);
-  assert(new_page != nullptr);
-  N *new_pageN = reinterpret_cast<N*>(new_page);
+  // next to node on disk, split leaves keep the leaf chain contiguous
+  new_page = buffer_pool_manager_->NewPageGuard(new_page_id,
+                                                node->GetPageId());
+  assert(new_page.IsValid());
+  new_page.SetDirty();
+  N *new_pageN = new_page.As<N>();
   //2. mova half to newly page
-  new_pageN->Init(new_page_id, node->GetParentPageId());
+  new_pageN->Init(new_page_id, node->GetParentPageId(),
+                  buffer_pool_manager_->GetUsablePageSize());
   node->MoveHalfTo(new_pageN, buffer_pool_manager_);
-  std::cout << node->ToString(true) << std::endl;
-  std::cout << new_pageN->ToString(true) << std::endl;
+  TRACE_DEBUG("Split() moved %lld of %lld entries to page %lld",
+              new_pageN->GetSize(), node->GetSize() + new_pageN->GetSize(),
+              new_page_id);
   //3. return 
   return new_pageN;
 }
@@ -167,49 +255,49 @@ void BPLUSTREE_TYPE::InsertIntoParent(BPlusTreePage *old_node,
                                       BPlusTreePage *new_node,
                                       Transaction *transaction) {
 
-  std::cout << "InsertIntoParent() "<< transaction->GetThreadId() << std::endl;
+  TRACE_DEBUG("InsertIntoParent() page %lld", old_node->GetPageId());
   /* insert into new root */
   if (old_node->IsRootPage()) {
 //    std::cout << "split root..................................." << std::endl;
     //1. ask new page and cast to internal page
 	page_id_t page_id;
-    auto page_ptr = buffer_pool_manager_->NewPage(page_id);
-	assert(page_ptr != nullptr);
 	//latch first, add to tree second to avoid dead lock.
-	page_ptr->WLatch();
+    WritePageGuard guard(
+        buffer_pool_manager_->NewPageGuard(page_id, old_node->GetPageId()));
+	assert(guard.IsValid());
+	guard.SetDirty();
 	root_page_id_ = page_id;
     UpdateRootPageId();
     B_PLUS_TREE_INTERNAL_PAGE *new_root = 
-	  reinterpret_cast<B_PLUS_TREE_INTERNAL_PAGE*>(page_ptr->GetData());
+	  guard.As<B_PLUS_TREE_INTERNAL_PAGE>();
     //2. init new root
-	new_root->Init(root_page_id_, INVALID_PAGE_ID);
+	new_root->Init(root_page_id_, INVALID_PAGE_ID,
+	               buffer_pool_manager_->GetUsablePageSize());
 	//bug forget to update childrens parent id.
 	old_node->SetParentPageId(root_page_id_);
 	new_node->SetParentPageId(root_page_id_);
     //3. populate new root
 	new_root->PopulateNewRoot(old_node->GetPageId(), key, new_node->GetPageId());
-	//4. unpin new root
-	page_ptr->WUnlatch();
-	buffer_pool_manager_->UnpinPage(root_page_id_, true);
+	//4. the guard unlatches and unpins new root
 	return;
   }
   /* insert into exist parent */
   //1. fetch exist parent and cast to internal page
-  auto page_ptr = buffer_pool_manager_->FetchPage(old_node->GetParentPageId());
-  assert(page_ptr != nullptr);
-  B_PLUS_TREE_INTERNAL_PAGE *parent = 
-    reinterpret_cast<B_PLUS_TREE_INTERNAL_PAGE*>(page_ptr->GetData());
+  auto guard =
+      buffer_pool_manager_->FetchPageGuard(old_node->GetParentPageId());
+  assert(guard.IsValid());
+  guard.SetDirty();
+  B_PLUS_TREE_INTERNAL_PAGE *parent = guard.As<B_PLUS_TREE_INTERNAL_PAGE>();
   //2. insert into parent
   parent->InsertNodeAfter(old_node->GetPageId(), key, new_node->GetPageId());
   //3. if parent is full, then split it recursively
   if (parent->GetSize() > parent->GetMaxSize()) {
-    auto new_parent = Split(parent);
+    PageGuard new_parent_guard;
+    auto new_parent = Split(parent, new_parent_guard);
   //4. insert parent into parent's parent
 	InsertIntoParent(parent, new_parent->KeyAt(0), new_parent, transaction);
-    buffer_pool_manager_->UnpinPage(new_parent->GetPageId(), true);
   }
-  //5. unpin all page
-  buffer_pool_manager_->UnpinPage(parent->GetPageId(), true);
+  //5. the guards unpin all page
   return;
 }
 
@@ -226,7 +314,7 @@ void BPLUSTREE_TYPE::InsertIntoParent(BPlusTreePage *old_node,
 /////////////////////////////////////////////////////////////////////
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::Remove(const KeyType &key, Transaction *transaction) {
-  std::cout << "Remove() " << transaction->GetThreadId()<< std::endl;
+  TRACE_DEBUG("Remove()");
   if (IsEmpty()) return;
   auto leaf_page_ptr = FindLeafPage(key, OpType::DELETE, transaction, false);
   if (leaf_page_ptr == nullptr) return;
@@ -241,9 +329,9 @@ void BPLUSTREE_TYPE::Remove(const KeyType &key, Transaction *transaction) {
 	}
   }
 //  std::cout << "after remove: " <<  leaf_page_ptr->ToString(true) << std::endl;
-  FreePages(true, transaction);
+  FreePages(transaction);
 //  buffer_pool_manager_->UnpinPage(leaf_page_ptr->GetPageId(), true);
-  std::cout << "Remove() done" << std::endl;
+  TRACE_DEBUG("Remove() done");
 }
 
 /*
@@ -258,12 +346,13 @@ template <typename N>
 bool BPLUSTREE_TYPE::CoalesceOrRedistribute(N *node, Transaction *transaction) {
   // a. get sibling node
   //case1: node is root page
-  std::cout << "CoalesceOrRedistribute() "<< transaction->GetThreadId() << std::endl;
+  TRACE_DEBUG("CoalesceOrRedistribute() page %lld", node->GetPageId());
   if (node->IsRootPage())
     return AdjustRoot(node); 
-  auto page = buffer_pool_manager_->FetchPage(node->GetParentPageId());
-  B_PLUS_TREE_INTERNAL_PAGE *parent = 
-    reinterpret_cast<B_PLUS_TREE_INTERNAL_PAGE*>(page->GetData());
+  PageGuard guard =
+      buffer_pool_manager_->FetchPageGuard(node->GetParentPageId());
+  guard.SetDirty();
+  B_PLUS_TREE_INTERNAL_PAGE *parent = guard.As<B_PLUS_TREE_INTERNAL_PAGE>();
   auto index = parent->ValueIndex(node->GetPageId());
   N *sibling_node;
   bool is_parent_deleted = false;
@@ -283,13 +372,11 @@ bool BPLUSTREE_TYPE::CoalesceOrRedistribute(N *node, Transaction *transaction) {
   if (sibling_node->GetSize() > sibling_node->GetMinSize()) {//redistribute
     Redistribute(sibling_node, node, index);  
 //    buffer_pool_manager_->UnpinPage(node->GetPageId(), true);
-    buffer_pool_manager_->UnpinPage(parent->GetPageId(), true);
 //    buffer_pool_manager_->UnpinPage(sibling_node->GetPageId(), true);
 	res = false;
   } else {//coalesce
     is_parent_deleted = 
 	    Coalesce(sibling_node, node, parent, index, transaction);  
-    buffer_pool_manager_->UnpinPage(parent->GetPageId(), true);
 	if (is_parent_deleted) {
 	  transaction->AddIntoDeletedPageSet(parent->GetPageId());
 //      buffer_pool_manager_->DeletePage(parent->GetPageId());
@@ -304,7 +391,7 @@ bool BPLUSTREE_TYPE::CoalesceOrRedistribute(N *node, Transaction *transaction) {
 	  res = true;
 	}
   }
-  std::cout << "CoalesceOrRedistribute() done" << transaction->GetThreadId()<< std::endl;
+  TRACE_DEBUG("CoalesceOrRedistribute() done");
   return res;
 }
 
@@ -326,7 +413,8 @@ bool BPLUSTREE_TYPE::Coalesce(
     N *&neighbor_node, N *&node,
     BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> *&parent,
     int index, Transaction *transaction) {
-  std::cout << "Coalesce() " << transaction->GetThreadId()<< std::endl;
+  TRACE_DEBUG("Coalesce() page %lld into %lld", node->GetPageId(),
+              neighbor_node->GetPageId());
   N *left_node, *right_node;
   if (index != 0) {
     left_node = neighbor_node;
@@ -349,7 +437,7 @@ bool BPLUSTREE_TYPE::Coalesce(
     return CoalesceOrRedistribute(parent, transaction);
   }
 //  buffer_pool_manager_->UnpinPage(parent->GetPageId(), true);
-  std::cout << "Coalesce() done" << transaction->GetThreadId()<< std::endl;
+  TRACE_DEBUG("Coalesce() done");
   return false;
 }
 
@@ -365,13 +453,13 @@ bool BPLUSTREE_TYPE::Coalesce(
 INDEX_TEMPLATE_ARGUMENTS
 template <typename N>
 void BPLUSTREE_TYPE::Redistribute(N *neighbor_node, N *node, int index) {
-  std::cout << "Redistribute() " << std::endl;
+  TRACE_DEBUG("Redistribute() page %lld", node->GetPageId());
   if (index != 0) { 
     neighbor_node->MoveLastToFrontOf(node, index, buffer_pool_manager_); 
   } else {
     neighbor_node->MoveFirstToEndOf(node, buffer_pool_manager_);
   }
-  std::cout << "Redistribute() done" << std::endl;
+  TRACE_DEBUG("Redistribute() done");
 }
 /*
  * Update root page if necessary
@@ -385,7 +473,7 @@ void BPLUSTREE_TYPE::Redistribute(N *neighbor_node, N *node, int index) {
  */
 INDEX_TEMPLATE_ARGUMENTS
 bool BPLUSTREE_TYPE::AdjustRoot(BPlusTreePage *old_root_node) {
-  std::cout << "AdjustRoot() " << std::endl;
+  TRACE_DEBUG("AdjustRoot() page %lld", old_root_node->GetPageId());
   if (!old_root_node->IsLeafPage()) {
 	assert(old_root_node->GetSize() == 1);
     //case 1
@@ -393,16 +481,14 @@ bool BPLUSTREE_TYPE::AdjustRoot(BPlusTreePage *old_root_node) {
 	B_PLUS_TREE_INTERNAL_PAGE *root = 
 	    reinterpret_cast<B_PLUS_TREE_INTERNAL_PAGE*>(old_root_node);
     page_id = root->RemoveAndReturnOnlyChild();     
-	auto page = buffer_pool_manager_->FetchPage(page_id);
-	assert(page != nullptr);
-//	page->WLatch();
+	auto guard = buffer_pool_manager_->FetchPageGuard(page_id);
+	assert(guard.IsValid());
+	guard.SetDirty();
 	B_PLUS_TREE_INTERNAL_PAGE *new_root = 
-	  reinterpret_cast<B_PLUS_TREE_INTERNAL_PAGE*>(page->GetData());
+	  guard.As<B_PLUS_TREE_INTERNAL_PAGE>();
 	new_root->SetParentPageId(INVALID_PAGE_ID);
 	root_page_id_ = page_id;
     UpdateRootPageId();
-//	page->WUnlatch();
-	buffer_pool_manager_->UnpinPage(root_page_id_, true);
 //	buffer_pool_manager_->UnpinPage(old_root_node->GetPageId(), false);
 //	buffer_pool_manager_->DeletePage(old_root_node->GetPageId());
 	return true;
@@ -415,7 +501,6 @@ bool BPLUSTREE_TYPE::AdjustRoot(BPlusTreePage *old_root_node) {
 	UpdateRootPageId();
 	return true;
   }
-  std::cout << "AdjustRoot() done" << std::endl;
   return false;
 }
 
@@ -451,7 +536,7 @@ INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin(const KeyType &key) {
 INDEX_TEMPLATE_ARGUMENTS
 B_PLUS_TREE_LEAF_PAGE_TYPE *BPLUSTREE_TYPE::FindLeafPage(const KeyType &key, 
 	OpType optype, Transaction *transaction, bool leftMost, bool *is_exclusive) {
-  std::cout << "FindLeafPage() " << transaction->GetThreadId()<< std::endl;
+  TRACE_DEBUG("FindLeafPage() optype %lld", static_cast<int>(optype));
   bool is_read_only = optype == OpType::SEARCH;
   auto leaf_page = TraverseTree(key, leftMost, optype, false, transaction); 
   bool is_already_exist = false;
@@ -468,52 +553,33 @@ B_PLUS_TREE_LEAF_PAGE_TYPE *BPLUSTREE_TYPE::FindLeafPage(const KeyType &key,
   } else if (leaf_page->IsSafe(optype) && 
              !leaf_page->IsRootPage()) {//transfor Rlatch to Wlatch
     auto page_id = leaf_page->GetPageId();
-    auto page = buffer_pool_manager_->FetchPage(page_id);
-	page->RUnlatch();
-	transaction->GetPageSet()->pop_front();
-	buffer_pool_manager_->UnpinPage(page_id, false);
-//    FreePages(false, transaction);
-	page->WLatch();
-	//if leaf_page has been deleted by other thread.
-	if (page->GetPageId() != page_id) {
-	  page->WUnlatch();
-      FreePages(false, transaction);
-	  leaf_page = FindLeafPage(key, optype, transaction, leftMost, is_exclusive);
-	//leaf_page has been modified by other thread.
-	} else if (!leaf_page->IsSafe(optype)) {
-	  buffer_pool_manager_->UnpinPage(page_id, false);
-	  page->WUnlatch();
-      FreePages(false, transaction);
-	  leaf_page = FindLeafPage(key, optype, transaction, leftMost, is_exclusive);
-	} else if (optype == OpType::INSERT) {
-	  //get write latch now, we can unlatch parent page.
-	  auto parent_page_id = leaf_page->GetParentPageId();
-	  auto page_set = transaction->GetPageSet();
-	  auto parent = page_set->back();
-	  page_set->pop_back();
-	  std::cout << "parent_id=" << parent_page_id << " ?= "
-	            << parent->GetPageId() << std::endl;
-	  assert(parent_page_id == parent->GetPageId());
-	  parent->RUnlatch();
-	  buffer_pool_manager_->UnpinPage(parent_page_id, false);
-//      is_already_exist = leaf_page->Lookup(key, v, comparator_);
-//      if (is_already_exist) {
-      transaction->AddIntoPageSet(page); 
-	  assert(is_exclusive != nullptr);
-	  *is_exclusive = true; 
-//	  }
-	} else {
-      transaction->AddIntoPageSet(page); 
+    // a second pin keeps the frame while the read latch is given up
+    PageGuard pin(buffer_pool_manager_,
+                  buffer_pool_manager_->FetchPage(page_id));
+    auto page_set = transaction->GetReadPageSet();
+	page_set->pop_front();
+	WritePageGuard guard(std::move(pin));
+	guard.SetDirty();
+	//leaf_page has been deleted or modified by other thread.
+	if (guard.GetPageId() != page_id || !leaf_page->IsSafe(optype)) {
+	  guard.Drop();
+      FreePages(transaction);
+	  return FindLeafPage(key, optype, transaction, leftMost, is_exclusive);
 	}
+	//get write latch now, we can unlatch parent page.
+	TRACE_DEBUG("FindLeafPage() leaf %lld write latched, %lld parents released",
+	            page_id, page_set->size());
+	page_set->clear();
+	if (is_exclusive != nullptr) {
+	  *is_exclusive = true;
+	}
+    transaction->AddIntoPageSet(std::move(guard));
 	return leaf_page;
   } else {
-    FreePages(false, transaction);
+    FreePages(transaction);
     leaf_page = TraverseTree(key, leftMost, optype, true, transaction);
-	if (optype == OpType::INSERT) {
-      is_already_exist = leaf_page->Lookup(key, v, comparator_);
-      if (is_already_exist) {
-        FreePages(true, transaction);
-	  }
+	if (is_exclusive != nullptr) {
+	  *is_exclusive = true;
 	}
   }
   return leaf_page;
@@ -522,9 +588,9 @@ B_PLUS_TREE_LEAF_PAGE_TYPE *BPLUSTREE_TYPE::FindLeafPage(const KeyType &key,
 INDEX_TEMPLATE_ARGUMENTS
 B_PLUS_TREE_LEAF_PAGE_TYPE *BPLUSTREE_TYPE::FindLeafPage(const KeyType &key,
 	bool leftMost) {
-  std::cout << "FindLeafPage:  " << key << std::endl;
+  TRACE_VERBOSE("FindLeafPage() leftmost %lld", leftMost);
   if (IsEmpty()) return nullptr;
-  auto page = buffer_pool_manager_->FetchPage(root_page_id_);
+  auto page = FetchHintedPage(root_page_id_);
   assert(page != nullptr);
   page->RLatch();
   BPlusTreePage *cur_page = 
@@ -537,7 +603,7 @@ B_PLUS_TREE_LEAF_PAGE_TYPE *BPLUSTREE_TYPE::FindLeafPage(const KeyType &key,
 	  cur_page_id = cur_internal_page->ValueAt(0);
 	else 
 	  cur_page_id = cur_internal_page->Lookup(key, comparator_);
-	auto next_page = buffer_pool_manager_->FetchPage(cur_page_id);	
+	auto next_page = FetchHintedPage(cur_page_id);
 	next_page->RLatch();
 	page->RUnlatch();
 	page = next_page;
@@ -557,7 +623,8 @@ B_PLUS_TREE_LEAF_PAGE_TYPE *BPLUSTREE_TYPE::FindLeafPage(const KeyType &key,
 INDEX_TEMPLATE_ARGUMENTS
 B_PLUS_TREE_LEAF_PAGE_TYPE *BPLUSTREE_TYPE::TraverseTree(const KeyType &key,
 	bool leftMost,OpType optype, bool is_exclusive, Transaction *transaction) {
-  std::cout << "TraverseTree():  " << key << "" << transaction->GetThreadId()<< std::endl;
+  TRACE_DEBUG("TraverseTree() leftmost %lld exclusive %lld", leftMost,
+              is_exclusive);
   BPlusTreePage *cur_page = nullptr;
   while (cur_page == nullptr) {
     if (IsEmpty()) return nullptr;
@@ -566,7 +633,8 @@ B_PLUS_TREE_LEAF_PAGE_TYPE *BPLUSTREE_TYPE::TraverseTree(const KeyType &key,
   for (auto cur_page_id = root_page_id_; !cur_page->IsLeafPage();) {
 	B_PLUS_TREE_INTERNAL_PAGE *cur_internal_page = 
 	  static_cast<B_PLUS_TREE_INTERNAL_PAGE*>(cur_page);
-	std::cout << "TraverseTree: " <<  cur_internal_page->ToString(true) << std::endl;
+	TRACE_VERBOSE("TraverseTree() internal page %lld size %lld",
+	              cur_internal_page->GetPageId(), cur_internal_page->GetSize());
 	if (leftMost) 
 	  cur_page_id = cur_internal_page->ValueAt(0);
 	else 
@@ -577,45 +645,47 @@ B_PLUS_TREE_LEAF_PAGE_TYPE *BPLUSTREE_TYPE::TraverseTree(const KeyType &key,
 	//	std::cout << "FindLeafPage: cur_page_id=" << cur_page_id << std::endl;
   }
   auto res = static_cast<B_PLUS_TREE_LEAF_PAGE_TYPE*>(cur_page);
-  std::cout << "FindLeafPage: " <<  res->ToString(true) << std::endl;
+  TRACE_DEBUG("TraverseTree() leaf %lld", res->GetPageId());
   return res;
-  std::cout << "TraverseTree():  " << key << "done " << transaction->GetThreadId()<< std::endl;
 }
 
 /*
- * Helper fuc for concurrent index
+ * Helper fuc for concurrent index: latch page_id and keep its guard in the
+ * page set of transaction. Once the page is safe for optype its ancestors are
+ * released.
+ * return nullptr if the page was deleted by another thread meanwhile
  */
 INDEX_TEMPLATE_ARGUMENTS
 BPlusTreePage *BPLUSTREE_TYPE::FetchPageWithLock(const page_id_t &page_id, OpType optype,
 	bool is_exclusive, Transaction *transaction) {
-  std::cout << "FetchPageWithLock:  " << page_id << " " << transaction->GetThreadId()<< std::endl;
+  TRACE_DEBUG("FetchPageWithLock() page %lld", page_id);
   assert(transaction != nullptr);
-  auto page = buffer_pool_manager_->FetchPage(page_id); 
-  assert(page != nullptr);
+  PageGuard pin(buffer_pool_manager_, FetchHintedPage(page_id));
+  assert(pin.IsValid());
   if (is_exclusive) {
-    page->WLatch();
-    if (page->GetPageId() != page_id) {
-      page->WUnlatch();
-	  return nullptr; 
-	}
-  } else {
-    page->RLatch();
-    if (page->GetPageId() != page_id) { 
-      page->RUnlatch();
-	  return nullptr; 
-	}
+    WritePageGuard guard(std::move(pin));
+    //if page has been deleted by other thread, return nullptr.
+    if (guard.GetPageId() != page_id)
+      return nullptr;
+    guard.SetDirty();
+    BPlusTreePage *cur_page = guard.As<BPlusTreePage>();
+    if (cur_page->IsSafe(optype)) {
+      TRACE_DEBUG("FetchPageWithLock() page %lld is safe", page_id);
+      FreePages(transaction);
+    }
+    transaction->AddIntoPageSet(std::move(guard));
+    return cur_page;
   }
-  //if page has been deleted by other thread, return nullptr.
-  BPlusTreePage *cur_page = 
-	reinterpret_cast<BPlusTreePage*>(page->GetData());
+  ReadPageGuard guard(std::move(pin));
+  if (guard.GetPageId() != page_id)
+    return nullptr;
+  BPlusTreePage *cur_page = guard.As<BPlusTreePage>();
   //case Insert is complex, so deal with it specially.
-  if ((!is_exclusive && 
-       (optype != OpType::INSERT || !cur_page->IsLeafPage()))
-      || (is_exclusive && cur_page->IsSafe(optype))) {
-    std::cout << "FetchPageWithLock:  need freepage" << std::endl;
-    FreePages(is_exclusive, transaction); 
+  if (optype != OpType::INSERT || !cur_page->IsLeafPage()) {
+    TRACE_DEBUG("FetchPageWithLock() page %lld is safe", page_id);
+    FreePages(transaction);
   }
-  transaction->AddIntoPageSet(page);
+  transaction->AddIntoPageSet(std::move(guard));
   return cur_page;
 }
 /*
@@ -625,39 +695,46 @@ INDEX_TEMPLATE_ARGUMENTS
 template <typename N> N *BPLUSTREE_TYPE::FetchSiblingPage(const page_id_t &page_id,
     Transaction *transaction) {
   assert(transaction != nullptr);
-  auto page = 
-	  buffer_pool_manager_->FetchPage(page_id);
-  assert(page != nullptr);
-  page->WLatch(); 
-  transaction->AddIntoPageSet(page);
-  N *res = reinterpret_cast<N*>(page->GetData());
+  WritePageGuard guard(
+      PageGuard(buffer_pool_manager_, FetchHintedPage(page_id)));
+  assert(guard.IsValid());
+  guard.SetDirty();
+  N *res = guard.As<N>();
+  transaction->AddIntoPageSet(std::move(guard));
   return res;
 }
 /*
- * Helper fuc for concurrent index
+ * Helper fuc for concurrent index: unlatch and unpin all pages held by
+ * transaction, the leaf first and the root last, then delete the pages the
+ * operation emptied. Optimistic readers and frame hint probes pin pages for
+ * a moment without latching them, a page they hold cannot be deleted yet and
+ * is tried again by the next operations.
  */
 INDEX_TEMPLATE_ARGUMENTS
-void BPLUSTREE_TYPE::FreePages(bool is_exclusive, Transaction *transaction) {
-  std::cout << "FreePages:  " << transaction->GetThreadId()<< std::endl;
+void BPLUSTREE_TYPE::FreePages(Transaction *transaction) {
   assert(transaction != nullptr);
-  for (auto page : *transaction->GetPageSet()) {
-    auto page_id = page->GetPageId();
-    if (is_exclusive) {
-	  page->WUnlatch();
-	} else {
-	  page->RUnlatch();
-	}
-    std::cout << "FreePages: WUnlatch" << page_id << transaction->GetThreadId()<< std::endl;
-	buffer_pool_manager_->UnpinPage(page_id, is_exclusive);
-	if (transaction->GetDeletedPageSet()->find(page_id) !=
-	    transaction->GetDeletedPageSet()->end()) {
-      buffer_pool_manager_->DeletePage(page_id);
-	  transaction->GetDeletedPageSet()->erase(page_id);
-    }
+  auto read_set = transaction->GetReadPageSet();
+  auto write_set = transaction->GetPageSet();
+  TRACE_DEBUG("FreePages() %lld pages", read_set->size() + write_set->size());
+  while (!read_set->empty())
+    read_set->pop_front();
+  while (!write_set->empty())
+    write_set->pop_front();
+  auto deleted_set = transaction->GetDeletedPageSet();
+  if (deleted_set->empty() && num_deferred_pages_.load() == 0)
+    return;
+  std::lock_guard<std::mutex> lck(deferred_latch_);
+  deferred_pages_.insert(deferred_pages_.end(), deleted_set->begin(),
+                         deleted_set->end());
+  deleted_set->clear();
+  size_t kept = 0;
+  for (auto page_id : deferred_pages_) {
+    if (!buffer_pool_manager_->DeletePage(page_id))
+      deferred_pages_[kept++] = page_id;
   }
-  assert(transaction->GetDeletedPageSet()->empty());
-  transaction->GetPageSet()->clear();
-  std::cout << "FreePages:  done" << transaction->GetThreadId()<< std::endl;
+  deferred_pages_.resize(kept);
+  num_deferred_pages_ = kept;
+  TRACE_DEBUG("FreePages() done, %lld deletes deferred", kept);
 }
 /*
  * Update/Insert root page id in header page(where page_id = 0, header_page is
@@ -669,15 +746,15 @@ void BPLUSTREE_TYPE::FreePages(bool is_exclusive, Transaction *transaction) {
  */
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::UpdateRootPageId(int insert_record) {
-  HeaderPage *header_page = static_cast<HeaderPage *>(
-	  buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+  auto guard = buffer_pool_manager_->FetchPageGuard(HEADER_PAGE_ID);
+  guard.SetDirty();
+  HeaderPage *header_page = static_cast<HeaderPage *>(guard.GetPage());
   if (insert_record)
 	// create a new record<index_name + root_page_id> in header_page
 	header_page->InsertRecord(index_name_, root_page_id_);
   else
 	// update root_page_id in header_page
 	header_page->UpdateRecord(index_name_, root_page_id_);
-  buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, true);
 }
 
 /*
@@ -18,6 +18,7 @@ INDEXITERATOR_TYPE::IndexIterator(int index,
     : index_(index), item_(item), buffer_pool_manager_(bm) {
   cur_page_ = bm->FetchPage(item->GetPageId());	
   bm->UnpinPage(item->GetPageId(), false);
+  Prefetch();
 //  cur_page_->RLatch();
 }
 
@@ -31,8 +31,10 @@ page_id_t TablePage::GetPrevPageId() {
   return *reinterpret_cast<page_id_t *>(GetData() + 8);
 }
 
-page_id_t TablePage::GetNextPageId() {
-  return *reinterpret_cast<page_id_t *>(GetData() + 12);
+page_id_t TablePage::GetNextPageId() { return GetNextPageId(GetData()); }
+
+page_id_t TablePage::GetNextPageId(const char *page_data) {
+  return *reinterpret_cast<const page_id_t *>(page_data + 12);
 }
 
 void TablePage::SetPrevPageId(page_id_t prev_page_id) {
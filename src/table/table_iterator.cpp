@@ -3,15 +3,18 @@
  */
 
 #include <cassert>
+#include <utility>
 
 #include "table/table_heap.h"
 
 namespace cmudb {
 
-TableIterator::TableIterator(TableHeap *table_heap, RID rid, Transaction *txn)
-    : table_heap_(table_heap), tuple_(new Tuple(rid)), txn_(txn) {
+TableIterator::TableIterator(TableHeap *table_heap, RID rid, Transaction *txn,
+                             BufferAccessStrategy *strategy)
+    : table_heap_(table_heap), tuple_(new Tuple(rid)), txn_(txn),
+      strategy_(strategy) {
   if (rid.GetPageId() != INVALID_PAGE_ID) {
-    table_heap_->GetTuple(tuple_->rid_, *tuple_, txn_);
+    table_heap_->GetTuple(tuple_->rid_, *tuple_, txn_, strategy_);
   }
 };
 
@@ -27,21 +30,24 @@ Tuple *TableIterator::operator->() {
 
 TableIterator &TableIterator::operator++() {
   BufferPoolManager *buffer_pool_manager = table_heap_->buffer_pool_manager_;
-  auto cur_page = static_cast<TablePage *>(
-      buffer_pool_manager->FetchPage(tuple_->rid_.GetPageId()));
-  cur_page->RLatch();
-  assert(cur_page != nullptr); // all pages are pinned
+  auto guard =
+      buffer_pool_manager->FetchPageRead(tuple_->rid_.GetPageId(), strategy_);
+  assert(guard.IsValid()); // all pages are pinned
+  auto cur_page = static_cast<TablePage *>(guard.GetPage());
 
   RID next_tuple_rid;
   if (!cur_page->GetNextTupleRid(tuple_->rid_,
                                  next_tuple_rid)) { // end of this page
     while (cur_page->GetNextPageId() != INVALID_PAGE_ID) {
-      auto next_page = static_cast<TablePage *>(
-          buffer_pool_manager->FetchPage(cur_page->GetNextPageId()));
-      cur_page->RUnlatch();
-      buffer_pool_manager->UnpinPage(cur_page->GetPageId(), false);
-      cur_page = next_page;
-      cur_page->RLatch();
+      // latch the next page before the current one is released
+      auto next_guard = buffer_pool_manager->FetchPageRead(
+          cur_page->GetNextPageId(), strategy_);
+      guard = std::move(next_guard);
+      cur_page = static_cast<TablePage *>(guard.GetPage());
+      // keep the pages behind the new one coming while its tuples are read
+      buffer_pool_manager->PrefetchPage(cur_page->GetNextPageId(),
+                                        READ_AHEAD_DEPTH,
+                                        &TablePage::GetNextPageId);
       if (cur_page->GetFirstTupleRid(next_tuple_rid))
         break;
     }
@@ -49,11 +55,9 @@ TableIterator &TableIterator::operator++() {
   tuple_->rid_ = next_tuple_rid;
 
   if (*this != table_heap_->end()) {
-    table_heap_->GetTuple(tuple_->rid_, *tuple_, txn_);
+    table_heap_->GetTuple(tuple_->rid_, *tuple_, txn_, strategy_);
   }
-  // release until copy the tuple
-  cur_page->RUnlatch();
-  buffer_pool_manager->UnpinPage(cur_page->GetPageId(), false);
+  // the guard releases the page once the tuple is copied
   return *this;
 }
 
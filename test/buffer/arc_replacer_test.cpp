@@ -0,0 +1,185 @@
+/**
+ * arc_replacer_test.cpp
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <unordered_set>
+#include <vector>
+
+#include "buffer/arc_replacer.h"
+#include "buffer/buffer_pool_manager.h"
+#include "buffer/clock_replacer.h"
+#include "buffer/lru_k_replacer.h"
+#include "buffer/lru_replacer.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(ARCReplacerTest, SampleTest) {
+  ARCReplacer<int> arc_replacer(4);
+
+  // 1 and 2 are hit twice and move to T2
+  for (int i = 1; i <= 4; ++i) {
+    arc_replacer.RecordAccess(i);
+  }
+  arc_replacer.RecordAccess(1);
+  arc_replacer.RecordAccess(2);
+  for (int i = 1; i <= 4; ++i) {
+    arc_replacer.Insert(i);
+  }
+  EXPECT_EQ(4, arc_replacer.Size());
+
+  // T1 is above its target, so its values go first
+  int value;
+  arc_replacer.Victim(value);
+  EXPECT_EQ(3, value);
+
+  // 3 comes back while remembered in B1: target of T1 grows, 3 joins T2
+  arc_replacer.RecordAccess(3);
+  arc_replacer.Insert(3);
+  EXPECT_EQ(1, arc_replacer.GetTarget());
+
+  // pinned values are skipped
+  EXPECT_EQ(true, arc_replacer.Erase(4));
+  arc_replacer.Victim(value);
+  EXPECT_EQ(1, value);
+  EXPECT_EQ(false, arc_replacer.Erase(1));
+
+  // 1 comes back from B2: target shrinks again
+  arc_replacer.RecordAccess(1);
+  arc_replacer.Insert(1);
+  EXPECT_EQ(0, arc_replacer.GetTarget());
+
+  arc_replacer.Remove(4);
+  EXPECT_EQ(3, arc_replacer.Size());
+  arc_replacer.Victim(value);
+  EXPECT_EQ(2, value);
+  arc_replacer.Victim(value);
+  EXPECT_EQ(3, value);
+  arc_replacer.Victim(value);
+  EXPECT_EQ(1, value);
+  EXPECT_EQ(false, arc_replacer.Victim(value));
+}
+
+TEST(ARCReplacerTest, BufferPoolTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm =
+      new BufferPoolManager(4, disk_manager, nullptr, 1, ReplacerType::ARC);
+
+  for (int i = 0; i < 12; ++i) {
+    auto page = bpm->NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, true));
+  }
+  for (int round = 0; round < 2; ++round) {
+    for (int i = 0; i < 12; ++i) {
+      auto page = bpm->FetchPage(i);
+      ASSERT_NE(nullptr, page);
+      char expected[PAGE_SIZE];
+      snprintf(expected, PAGE_SIZE, "page %d", i);
+      EXPECT_EQ(0, strcmp(page->GetData(), expected));
+      EXPECT_EQ(true, bpm->UnpinPage(i, false));
+    }
+  }
+  EXPECT_EQ(true, bpm->DeletePage(11));
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+/*
+ * Replay a page-access trace against a replacer the way the buffer pool
+ * drives it (access, then unpin right away) and return the hit rate.
+ */
+static double ReplayTrace(Replacer<int> *replacer, size_t capacity,
+                          const std::vector<int> &trace) {
+  std::unordered_set<int> resident;
+  size_t hits = 0;
+  for (auto page_id : trace) {
+    if (resident.count(page_id)) {
+      ++hits;
+      replacer->Erase(page_id);
+    } else {
+      if (resident.size() == capacity) {
+        int victim;
+        EXPECT_EQ(true, replacer->Victim(victim));
+        resident.erase(victim);
+      }
+      resident.insert(page_id);
+    }
+    replacer->RecordAccess(page_id);
+    replacer->Insert(page_id);
+  }
+  return trace.empty() ? 0 : static_cast<double>(hits) / trace.size();
+}
+
+// hot index pages looked up between long sequential table scans
+static std::vector<int> ScanMixedTrace() {
+  std::mt19937 rng(15445);
+  std::vector<int> trace;
+  int next_scan_page = 1000;
+  for (int phase = 0; phase < 20; ++phase) {
+    for (int i = 0; i < 400; ++i)
+      trace.push_back(rng() % 40);
+    for (int i = 0; i < 300; ++i)
+      trace.push_back(next_scan_page++);
+  }
+  return trace;
+}
+
+// skewed point lookups: a few pages take most of the accesses
+static std::vector<int> LookupTrace() {
+  std::mt19937 rng(15721);
+  std::vector<int> trace;
+  for (int i = 0; i < 20000; ++i) {
+    int range = (rng() % 10 < 8) ? 40 : 400;
+    trace.push_back(rng() % range);
+  }
+  return trace;
+}
+
+/*
+ * Hit rate benchmark of ARC against the other policies. Besides the built-in
+ * traces, a recorded trace (page ids separated by whitespace) can be replayed
+ * by pointing REPLACER_TRACE at the file.
+ */
+TEST(ARCReplacerTest, HitRateBenchmark) {
+  const size_t capacity = 64;
+  std::vector<std::pair<std::string, std::vector<int>>> traces{
+      {"scan-mixed", ScanMixedTrace()}, {"lookup", LookupTrace()}};
+  const char *trace_file = getenv("REPLACER_TRACE");
+  if (trace_file != nullptr) {
+    std::ifstream input(trace_file);
+    std::vector<int> recorded;
+    int page_id;
+    while (input >> page_id)
+      recorded.push_back(page_id);
+    traces.emplace_back(trace_file, recorded);
+  }
+
+  for (auto &trace : traces) {
+    LRUReplacer<int> lru;
+    ClockReplacer<int> clock(capacity);
+    LRUKReplacer<int> lru_k(2);
+    ARCReplacer<int> arc(capacity);
+    double lru_rate = ReplayTrace(&lru, capacity, trace.second);
+    double clock_rate = ReplayTrace(&clock, capacity, trace.second);
+    double lru_k_rate = ReplayTrace(&lru_k, capacity, trace.second);
+    double arc_rate = ReplayTrace(&arc, capacity, trace.second);
+    printf("%-12s accesses=%zu lru=%.3f clock=%.3f lru-2=%.3f arc=%.3f\n",
+           trace.first.c_str(), trace.second.size(), lru_rate, clock_rate,
+           lru_k_rate, arc_rate);
+    if (trace_file == nullptr || trace.first != trace_file) {
+      EXPECT_GE(arc_rate, lru_rate);
+    }
+  }
+}
+
+} // namespace cmudb
@@ -2,9 +2,19 @@
  * buffer_pool_manager_test.cpp
  */
 
+#include <atomic>
+#include <chrono>
 #include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include "buffer/buffer_pool_manager.h"
+#include "common/exception.h"
 #include "gtest/gtest.h"
 
 namespace cmudb {
@@ -105,4 +115,816 @@ TEST(BufferPoolManagerTest, SampleTest2) {
 }
 
 
+TEST(BufferPoolManagerTest, PartitionTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(16, disk_manager, nullptr, 4);
+  EXPECT_EQ(4, bpm->GetNumPartitions());
+
+  // every partition gets 4 frames, page_id % 4 picks the partition
+  for (int i = 0; i < 16; ++i) {
+    auto page = bpm->NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(i, temp_page_id);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, true));
+  }
+
+  // hit-heavy workload from several threads on disjoint partitions
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.push_back(std::thread([bpm, t]() {
+      char expected[PAGE_SIZE];
+      for (int round = 0; round < 100; ++round) {
+        for (int i = t; i < 16; i += 4) {
+          auto page = bpm->FetchPage(i);
+          ASSERT_NE(nullptr, page);
+          snprintf(expected, PAGE_SIZE, "page %d", i);
+          EXPECT_EQ(0, strcmp(page->GetData(), expected));
+          EXPECT_EQ(true, bpm->UnpinPage(i, false));
+        }
+      }
+    }));
+  }
+  for (auto &thread : threads)
+    thread.join();
+
+  // page 16 has to evict a page of partition 0 only
+  auto page = bpm->NewPage(temp_page_id);
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ(16, temp_page_id);
+  EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, false));
+  page = bpm->FetchPage(0);
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ(0, strcmp(page->GetData(), "page 0"));
+  EXPECT_EQ(true, bpm->UnpinPage(0, false));
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(BufferPoolManagerTest, PrefetchTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(10, disk_manager);
+
+  // a chain of 30 pages, the first 4 bytes point to the next page
+  for (int i = 0; i < 30; ++i) {
+    auto page = bpm->NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    page_id_t next_page_id = i == 29 ? INVALID_PAGE_ID : i + 1;
+    memcpy(page->GetData(), &next_page_id, sizeof(page_id_t));
+    snprintf(page->GetData() + sizeof(page_id_t), 16, "page %d", i);
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, true));
+  }
+
+  NextPageFn next_page = [](const char *page_data) {
+    return *reinterpret_cast<const page_id_t *>(page_data);
+  };
+  // ids past the end of the file are ignored
+  bpm->PrefetchPage(1000);
+  // read-ahead races with the scan below and with new pages
+  bpm->PrefetchPage(0, 30, next_page);
+  char expected[16];
+  for (page_id_t page_id = 0; page_id != INVALID_PAGE_ID;) {
+    auto page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(expected, 16, "page %d", page_id);
+    EXPECT_EQ(0, strcmp(page->GetData() + sizeof(page_id_t), expected));
+    bpm->PrefetchPage(next_page(page->GetData()), READ_AHEAD_DEPTH,
+                      next_page);
+    page_id_t next_page_id = next_page(page->GetData());
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, false));
+    page_id = next_page_id;
+
+    auto new_page = bpm->NewPage(temp_page_id);
+    ASSERT_NE(nullptr, new_page);
+    EXPECT_EQ(0, new_page->GetData()[0]);
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, false));
+  }
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(BufferPoolManagerTest, FlushThreadTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(10, disk_manager);
+
+  for (int i = 0; i < 10; ++i) {
+    auto page = bpm->NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, true));
+  }
+  EXPECT_EQ(10, bpm->GetDirtyPageCount());
+
+  // keep every unpinned frame clean
+  bpm->RunFlushThread(1.0);
+  for (int i = 0; i < 100 && bpm->GetDirtyPageCount() > 0; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  bpm->StopFlushThread();
+  EXPECT_EQ(0, bpm->GetDirtyPageCount());
+  EXPECT_EQ(10, bpm->GetStats().background_writebacks_);
+
+  // eviction finds clean frames only, nothing is written on the fetch path
+  for (int i = 0; i < 10; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(temp_page_id));
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, false));
+  }
+  EXPECT_EQ(0, bpm->GetStats().eviction_writebacks_);
+  auto page = bpm->FetchPage(0);
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ(0, strcmp(page->GetData(), "page 0"));
+  EXPECT_EQ(true, bpm->UnpinPage(0, false));
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(BufferPoolManagerTest, FlushAllPagesTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(10, disk_manager, nullptr, 2);
+
+  // pages 3 and 7 stay clean, so three runs have to be written
+  for (int i = 0; i < 10; ++i) {
+    auto page = bpm->NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, i != 3 && i != 7));
+  }
+  EXPECT_EQ(8, bpm->FlushAllPages());
+  EXPECT_EQ(0, bpm->GetDirtyPageCount());
+  EXPECT_EQ(0, bpm->FlushAllPages());
+  delete bpm;
+
+  // a fresh pool reads the flushed pages back from disk
+  bpm = new BufferPoolManager(10, disk_manager);
+  char expected[PAGE_SIZE];
+  for (int i = 0; i < 10; ++i) {
+    auto page = bpm->FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    if (i == 3 || i == 7) {
+      EXPECT_EQ(0, page->GetData()[0]);
+    } else {
+      snprintf(expected, PAGE_SIZE, "page %d", i);
+      EXPECT_EQ(0, strcmp(page->GetData(), expected));
+    }
+    EXPECT_EQ(true, bpm->UnpinPage(i, false));
+  }
+
+  // a pinned page is flushed once its writer is done with it, never half
+  // changed
+  Page *page = bpm->FetchPage(5);
+  ASSERT_NE(nullptr, page);
+  page->WLatch();
+  memset(page->GetData(), 'a', PAGE_SIZE / 2);
+  EXPECT_EQ(true, bpm->UnpinPage(5, true));
+  ASSERT_NE(nullptr, bpm->FetchPage(5));
+  std::thread flusher([bpm] { EXPECT_EQ(1, bpm->FlushAllPages()); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  memset(page->GetData() + PAGE_SIZE / 2, 'b', PAGE_SIZE / 2);
+  page->WUnlatch();
+  flusher.join();
+  EXPECT_EQ(0, bpm->GetDirtyPageCount());
+  EXPECT_EQ(true, bpm->UnpinPage(5, false));
+  std::vector<char> image(PAGE_SIZE);
+  EXPECT_EQ(true, disk_manager->ReadPage(5, image.data()));
+  EXPECT_EQ('a', image[0]);
+  EXPECT_EQ('b', image[PAGE_SIZE / 2]);
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(BufferPoolManagerTest, PageSizeTest) {
+  page_id_t temp_page_id;
+  remove("test.db");
+
+  DiskManager *disk_manager = new DiskManager("test.db", 4096);
+  BufferPoolManager *bpm = new BufferPoolManager(4, disk_manager);
+  EXPECT_EQ(4096, bpm->GetPageSize());
+  for (int i = 0; i < 8; ++i) {
+    auto page = bpm->NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(4096, page->GetPageSize());
+    // the last bytes of the page have to survive a round trip to disk
+    snprintf(page->GetData() + 4096 - 16, 16, "page %d", i);
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, true));
+  }
+  bpm->FlushAllPages();
+  delete bpm;
+  delete disk_manager;
+
+  // the page size is taken from the file, not from the constructor
+  disk_manager = new DiskManager("test.db", 8192);
+  EXPECT_EQ(4096, disk_manager->GetPageSize());
+  EXPECT_EQ(8, disk_manager->GetNumPages());
+  bpm = new BufferPoolManager(4, disk_manager);
+  char expected[16];
+  for (int i = 0; i < 8; ++i) {
+    auto page = bpm->FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    snprintf(expected, 16, "page %d", i);
+    EXPECT_EQ(0, strcmp(page->GetData() + 4096 - 16, expected));
+    EXPECT_EQ(true, bpm->UnpinPage(i, false));
+  }
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+
+  EXPECT_THROW(DiskManager("test.db", 1000), Exception);
+  remove("test.db");
+}
+
+TEST(BufferPoolManagerTest, DeletePinnedPageTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(4, disk_manager);
+  Page *page = bpm->NewPage(temp_page_id);
+  ASSERT_NE(nullptr, page);
+  snprintf(page->GetData(), PAGE_SIZE, "pinned");
+
+  // a pinned page stays resident in its frame
+  EXPECT_EQ(false, bpm->DeletePage(temp_page_id));
+  EXPECT_EQ(temp_page_id, page->GetPageId());
+  EXPECT_EQ(1, page->GetPinCount());
+  EXPECT_EQ(page, bpm->FetchPage(temp_page_id));
+  EXPECT_EQ(0, strcmp(page->GetData(), "pinned"));
+  EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, true));
+  EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, false));
+  EXPECT_EQ(0, bpm->GetStats().deleted_pages_);
+
+  // once unpinned it can go
+  EXPECT_EQ(true, bpm->DeletePage(temp_page_id));
+  EXPECT_EQ(1, bpm->GetStats().deleted_pages_);
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(BufferPoolManagerTest, StatsTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(4, disk_manager);
+
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(temp_page_id));
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, true));
+  }
+  // pin the whole pool at once
+  for (int i = 0; i < 4; ++i)
+    ASSERT_NE(nullptr, bpm->FetchPage(i));
+  EXPECT_EQ(4, bpm->GetStats().pinned_frames_);
+  for (int i = 0; i < 4; ++i)
+    EXPECT_EQ(true, bpm->UnpinPage(i, false));
+
+  // page 4 and page 0 each replace a dirty page
+  ASSERT_NE(nullptr, bpm->NewPage(temp_page_id));
+  EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, false));
+  ASSERT_NE(nullptr, bpm->FetchPage(0));
+  EXPECT_EQ(true, bpm->UnpinPage(0, false));
+  EXPECT_EQ(true, bpm->DeletePage(4));
+  // pages 2 and 3 are still dirty
+  EXPECT_EQ(2, bpm->FlushAllPages());
+
+  BufferPoolStats stats = bpm->GetStats();
+  EXPECT_EQ(4, stats.hits_);
+  EXPECT_EQ(1, stats.misses_);
+  EXPECT_DOUBLE_EQ(0.8, stats.GetHitRatio());
+  EXPECT_EQ(2, stats.evictions_);
+  EXPECT_EQ(2, stats.eviction_writebacks_);
+  EXPECT_EQ(2, stats.flush_writebacks_);
+  EXPECT_EQ(5, stats.new_pages_);
+  EXPECT_EQ(1, stats.deleted_pages_);
+  EXPECT_EQ(4, stats.pool_size_);
+  EXPECT_EQ(0, stats.pinned_frames_);
+  EXPECT_EQ(4, stats.pinned_frames_high_water_);
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(BufferPoolManagerTest, PageGuardTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(4, disk_manager);
+
+  {
+    auto guard = bpm->NewPageGuard(temp_page_id);
+    ASSERT_EQ(true, guard.IsValid());
+    EXPECT_EQ(0, temp_page_id);
+    EXPECT_EQ(1, guard.GetPage()->GetPinCount());
+    // moving hands the pin over instead of taking another one
+    PageGuard other(std::move(guard));
+    EXPECT_EQ(false, guard.IsValid());
+    EXPECT_EQ(1, other.GetPage()->GetPinCount());
+    strcpy(other.GetData(), "Hello");
+    other.SetDirty();
+  }
+  EXPECT_EQ(0, bpm->GetStats().pinned_frames_);
+  EXPECT_EQ(1, bpm->GetDirtyPageCount());
+
+  {
+    WritePageGuard guard = bpm->FetchPageWrite(0);
+    ASSERT_EQ(true, guard.IsValid());
+    EXPECT_EQ(0, strcmp(guard.GetData(), "Hello"));
+    // dropping twice releases latch and pin only once
+    guard.Drop();
+    guard.Drop();
+    EXPECT_EQ(false, guard.IsValid());
+    EXPECT_EQ(0, bpm->GetStats().pinned_frames_);
+
+    // the write latch was released, readers can share the page
+    ReadPageGuard first = bpm->FetchPageRead(0);
+    ReadPageGuard second = bpm->FetchPageRead(0);
+    EXPECT_EQ(2, first.GetPage()->GetPinCount());
+    // assigning drops the page the guard held before
+    second = ReadPageGuard();
+    EXPECT_EQ(1, first.GetPage()->GetPinCount());
+  }
+  EXPECT_EQ(0, bpm->GetStats().pinned_frames_);
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(BufferPoolManagerTest, AccessStrategyTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(10, disk_manager);
+
+  for (int i = 0; i < 30; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(temp_page_id));
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, true));
+  }
+  bpm->FlushAllPages();
+  // working set, pages 25 to 29 stay resident as well
+  for (int i = 0; i < 5; ++i) {
+    ASSERT_NE(nullptr, bpm->FetchPage(i));
+    EXPECT_EQ(true, bpm->UnpinPage(i, false));
+  }
+
+  {
+    // a quarter of the pool at most
+    BufferAccessStrategy strategy(bpm, SCAN_RING_SIZE);
+    EXPECT_EQ(2, strategy.GetRingSize());
+    for (int i = 5; i < 25; ++i) {
+      Page *page = bpm->FetchPage(i, &strategy);
+      ASSERT_NE(nullptr, page);
+      EXPECT_EQ(i, page->GetPageId());
+      EXPECT_EQ(true, bpm->UnpinPage(i, false));
+    }
+    // somebody else needs the last page of the scan, it leaves the ring
+    ASSERT_NE(nullptr, bpm->FetchPage(24));
+    EXPECT_EQ(true, bpm->UnpinPage(24, false));
+  }
+
+  // the scan did not push out the working set
+  uint64_t misses = bpm->GetStats().misses_;
+  for (int i = 0; i < 5; ++i) {
+    ASSERT_NE(nullptr, bpm->FetchPage(i));
+    EXPECT_EQ(true, bpm->UnpinPage(i, false));
+  }
+  ASSERT_NE(nullptr, bpm->FetchPage(24));
+  EXPECT_EQ(true, bpm->UnpinPage(24, false));
+  EXPECT_EQ(misses, bpm->GetStats().misses_);
+  // the other ring page was dropped with the strategy
+  ASSERT_NE(nullptr, bpm->FetchPage(23));
+  EXPECT_EQ(true, bpm->UnpinPage(23, false));
+  EXPECT_EQ(misses + 1, bpm->GetStats().misses_);
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(BufferPoolManagerTest, ResizeTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(4, disk_manager, nullptr, 2);
+
+  for (int i = 0; i < 4; ++i)
+    ASSERT_NE(nullptr, bpm->NewPage(temp_page_id));
+  // grow while every frame is pinned
+  EXPECT_EQ(8, bpm->Resize(8));
+  EXPECT_EQ(8, bpm->GetPoolSize());
+  for (int i = 4; i < 8; ++i) {
+    Page *page = bpm->NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), 16, "page %d", i);
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, true));
+  }
+
+  // pinned frames cannot be taken away
+  EXPECT_EQ(4, bpm->Resize(2));
+  EXPECT_EQ(4, bpm->GetStats().pool_size_);
+  for (int i = 0; i < 4; ++i)
+    EXPECT_EQ(true, bpm->UnpinPage(i, false));
+  // one frame is left in each partition
+  EXPECT_EQ(2, bpm->Resize(1));
+
+  // evicted pages were written back
+  for (int i = 4; i < 8; ++i) {
+    Page *page = bpm->FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    char expected[16];
+    snprintf(expected, sizeof(expected), "page %d", i);
+    EXPECT_EQ(0, strcmp(page->GetData(), expected));
+    EXPECT_EQ(true, bpm->UnpinPage(i, false));
+  }
+
+  // fetches go on while the pool is resized
+  std::atomic<bool> done(false);
+  std::atomic<int> errors(0);
+  std::thread reader([&]() {
+    while (!done) {
+      for (int i = 0; i < 8; ++i) {
+        Page *page = bpm->FetchPage(i);
+        if (page == nullptr || page->GetPageId() != i)
+          ++errors;
+        else
+          bpm->UnpinPage(i, false);
+      }
+    }
+  });
+  for (int round = 0; round < 100; ++round) {
+    bpm->Resize(16);
+    bpm->Resize(4);
+  }
+  done = true;
+  reader.join();
+  EXPECT_EQ(0, errors);
+  EXPECT_EQ(4, bpm->GetPoolSize());
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(BufferPoolManagerTest, FrameWaitTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(2, disk_manager);
+  auto frame_wait_timeout = FRAME_WAIT_TIMEOUT;
+  FRAME_WAIT_TIMEOUT = std::chrono::milliseconds(5000);
+
+  for (int i = 0; i < 2; ++i)
+    ASSERT_NE(nullptr, bpm->NewPage(temp_page_id));
+  // both frames are pinned, the fetches wait and are served in order
+  std::vector<int> order;
+  std::mutex order_latch;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 3; ++i) {
+    threads.push_back(std::thread([&, i]() {
+      page_id_t page_id;
+      Page *page = bpm->NewPage(page_id);
+      ASSERT_NE(nullptr, page);
+      {
+        std::lock_guard<std::mutex> lck(order_latch);
+        order.push_back(i);
+      }
+      bpm->UnpinPage(page_id, false);
+    }));
+    // let the thread queue up before the next one starts
+    while (bpm->GetStats().frame_waits_ < static_cast<uint64_t>(i + 1))
+      std::this_thread::yield();
+  }
+  EXPECT_EQ(true, bpm->UnpinPage(0, false));
+  for (auto &thread : threads)
+    thread.join();
+  EXPECT_EQ((std::vector<int>{0, 1, 2}), order);
+  EXPECT_EQ(3, bpm->GetStats().frame_waits_);
+  EXPECT_EQ(0, bpm->GetStats().frame_wait_failures_);
+
+  // nobody unpins, the wait times out
+  FRAME_WAIT_TIMEOUT = std::chrono::milliseconds(10);
+  ASSERT_NE(nullptr, bpm->FetchPage(0));
+  EXPECT_EQ(nullptr, bpm->FetchPage(3));
+  EXPECT_EQ(1, bpm->GetStats().frame_wait_failures_);
+
+  FRAME_WAIT_TIMEOUT = frame_wait_timeout;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+/*
+ * Concurrent fetches of a working set somewhat larger than the pool, most hits
+ * should take the latch-free path while evictions go on.
+ */
+TEST(BufferPoolManagerTest, FastPathBenchmark) {
+  page_id_t temp_page_id;
+  const int num_pages = 96;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(64, disk_manager, nullptr, 4);
+  for (int i = 0; i < num_pages; ++i) {
+    Page *page = bpm->NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), 16, "page %d", i);
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, true));
+  }
+  BufferPoolStats before = bpm->GetStats();
+
+  std::atomic<int> errors(0);
+  std::vector<std::thread> threads;
+  auto start = std::chrono::steady_clock::now();
+  for (int t = 0; t < 4; ++t) {
+    threads.push_back(std::thread([&, t]() {
+      std::mt19937 rng(t);
+      char expected[16];
+      for (int i = 0; i < 20000; ++i) {
+        // three out of four fetches go to a hot set that fits the pool
+        page_id_t page_id = rng() % 4 ? rng() % 32 : rng() % num_pages;
+        Page *page = bpm->FetchPage(page_id);
+        snprintf(expected, sizeof(expected), "page %d", page_id);
+        if (page == nullptr || page->GetPageId() != page_id ||
+            strcmp(page->GetData(), expected) != 0)
+          ++errors;
+        if (page != nullptr)
+          bpm->UnpinPage(page_id, false);
+      }
+    }));
+  }
+  for (auto &thread : threads)
+    thread.join();
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+  BufferPoolStats stats = bpm->GetStats();
+  uint64_t hits = stats.hits_ - before.hits_;
+  uint64_t fast_hits = stats.fast_hits_ - before.fast_hits_;
+  uint64_t misses = stats.misses_ - before.misses_;
+  printf("fetches=%llu fast=%llu slow=%llu (misses=%llu) fast_ratio=%.3f "
+         "fetches/s=%.0f\n",
+         static_cast<unsigned long long>(hits + misses),
+         static_cast<unsigned long long>(fast_hits),
+         static_cast<unsigned long long>(hits + misses - fast_hits),
+         static_cast<unsigned long long>(misses),
+         static_cast<double>(fast_hits) / (hits + misses),
+         (hits + misses) / seconds);
+  EXPECT_EQ(0, errors);
+  EXPECT_EQ(80000, hits + misses);
+  EXPECT_LT(0, fast_hits);
+  EXPECT_EQ(0, stats.pinned_frames_);
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(BufferPoolManagerTest, MappedTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(4, disk_manager);
+  for (int i = 0; i < 8; ++i) {
+    Page *page = bpm->NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), 16, "page %d", i);
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, true));
+  }
+  bpm->FlushAllPages();
+  delete bpm;
+  delete disk_manager;
+
+  disk_manager = new DiskManager("test.db", PAGE_SIZE, true);
+  EXPECT_EQ(true, disk_manager->IsReadOnly());
+  EXPECT_EQ(8, disk_manager->GetNumPages());
+  bpm = new BufferPoolManager(4, disk_manager);
+  EXPECT_EQ(true, bpm->IsMapped());
+  EXPECT_EQ(0, bpm->GetPoolSize());
+  // more pages pinned at once than the pool would have had frames
+  std::vector<Page *> pages;
+  for (int i = 0; i < 8; ++i) {
+    Page *page = bpm->FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    char expected[16];
+    snprintf(expected, sizeof(expected), "page %d", i);
+    EXPECT_EQ(0, strcmp(page->GetData(), expected));
+    pages.push_back(page);
+  }
+  EXPECT_EQ(pages[3], bpm->FetchPage(3));
+  EXPECT_EQ(2, pages[3]->GetPinCount());
+  for (int i = 0; i < 8; ++i)
+    EXPECT_EQ(true, bpm->UnpinPage(i, false));
+  EXPECT_EQ(true, bpm->UnpinPage(3, false));
+  EXPECT_EQ(false, bpm->UnpinPage(3, false));
+  EXPECT_EQ(nullptr, bpm->FetchPage(8));
+  EXPECT_EQ(nullptr, bpm->NewPage(temp_page_id));
+  EXPECT_EQ(false, bpm->DeletePage(0));
+  EXPECT_EQ(0, bpm->FlushAllPages());
+  EXPECT_EQ(0, bpm->GetStats().pinned_frames_);
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(BufferPoolManagerTest, WarmupTest) {
+  page_id_t temp_page_id;
+  remove("test.warm");
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(8, disk_manager);
+  // no warm-up file yet, the pool starts cold
+  bpm->StartWarmup("test.warm");
+  for (int i = 0; i < 16; ++i) {
+    Page *page = bpm->NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), 16, "page %d", i);
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, true));
+  }
+  // pages 8..15 are resident, 12 was used last and 9 just before
+  for (int i : {9, 12}) {
+    ASSERT_NE(nullptr, bpm->FetchPage(i));
+    EXPECT_EQ(true, bpm->UnpinPage(i, false));
+  }
+  bpm->FlushAllPages();
+  delete bpm;
+
+  std::ifstream input("test.warm");
+  std::vector<page_id_t> page_ids;
+  page_id_t page_id;
+  while (input >> page_id)
+    page_ids.push_back(page_id);
+  ASSERT_EQ(8, page_ids.size());
+  EXPECT_EQ(12, page_ids[0]);
+  EXPECT_EQ(9, page_ids[1]);
+
+  // a smaller pool gets the hottest pages only
+  bpm = new BufferPoolManager(4, disk_manager);
+  bpm->StartWarmup("test.warm");
+  for (int i = 0; i < 1000 && bpm->GetStats().warmup_loads_ < 4; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  EXPECT_EQ(4, bpm->GetStats().warmup_loads_);
+  for (int i = 0; i < 4; ++i) {
+    Page *page = bpm->FetchPage(page_ids[i]);
+    ASSERT_NE(nullptr, page);
+    char expected[16];
+    snprintf(expected, sizeof(expected), "page %d", page_ids[i]);
+    EXPECT_EQ(0, strcmp(page->GetData(), expected));
+    EXPECT_EQ(true, bpm->UnpinPage(page_ids[i], false));
+  }
+  EXPECT_EQ(4, bpm->GetStats().hits_);
+  EXPECT_EQ(0, bpm->GetStats().misses_);
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.warm");
+}
+
+TEST(BufferPoolManagerTest, FrameHintTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(2, disk_manager);
+  for (int i = 0; i < 3; ++i) {
+    Page *page = bpm->NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), 16, "page %d", i);
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, true));
+  }
+
+  // the first fetch goes through the page table and fills the hint
+  std::atomic<Page *> hint(nullptr);
+  Page *page = bpm->FetchPageHinted(1, hint);
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ(page, hint.load());
+  EXPECT_EQ(true, bpm->UnpinPage(1, false));
+  EXPECT_EQ(0, bpm->GetStats().hint_hits_);
+  EXPECT_EQ(page, bpm->FetchPageHinted(1, hint));
+  EXPECT_EQ(true, bpm->UnpinPage(1, false));
+  EXPECT_EQ(1, bpm->GetStats().hint_hits_);
+
+  // page 1 is evicted, its frame now holds page 0
+  for (int i : {2, 0}) {
+    ASSERT_NE(nullptr, bpm->FetchPage(i));
+    EXPECT_EQ(true, bpm->UnpinPage(i, false));
+  }
+  page = bpm->FetchPageHinted(1, hint);
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ(1, page->GetPageId());
+  EXPECT_EQ(0, strcmp(page->GetData(), "page 1"));
+  EXPECT_EQ(page, hint.load());
+  EXPECT_EQ(1, bpm->GetStats().hint_hits_);
+  EXPECT_EQ(true, bpm->UnpinPage(1, false));
+  // the stale pin on the other frame was given back
+  EXPECT_EQ(0, bpm->GetStats().pinned_frames_);
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(BufferPoolManagerTest, FrameHintPartitionTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(6, disk_manager, nullptr, 3);
+  for (int i = 0; i < 30; ++i) {
+    Page *page = bpm->NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), 16, "page %d", i);
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, true));
+  }
+
+  // pages of different partitions share the hint, the frame of page 1 is
+  // handed back to its own partition
+  std::atomic<Page *> hint(nullptr);
+  ASSERT_NE(nullptr, bpm->FetchPageHinted(1, hint));
+  EXPECT_EQ(true, bpm->UnpinPage(1, false));
+  ASSERT_NE(nullptr, bpm->FetchPageHinted(2, hint));
+  EXPECT_EQ(true, bpm->UnpinPage(2, false));
+  for (int i = 5; i < 30; i += 3) {
+    ASSERT_NE(nullptr, bpm->FetchPage(i));
+    EXPECT_EQ(true, bpm->UnpinPage(i, false));
+  }
+  Page *page = bpm->FetchPage(1);
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ(1, page->GetPageId());
+  EXPECT_EQ(0, strcmp(page->GetData(), "page 1"));
+  EXPECT_EQ(true, bpm->UnpinPage(1, false));
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(BufferPoolManagerTest, ConcurrentMissTest) {
+  const int num_pages = 64;
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(8, disk_manager, nullptr, 2);
+  for (int i = 0; i < num_pages; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(temp_page_id));
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, false));
+  }
+  bpm->RunFlushThread(1.0);
+
+  // every page counts its own updates, misses read pages while other
+  // threads evict, write back and read the same pages
+  std::vector<std::thread> threads;
+  std::atomic<int> errors(0);
+  for (int t = 0; t < 8; ++t) {
+    threads.push_back(std::thread([&, t]() {
+      std::mt19937 rng(t);
+      for (int i = 0; i < 2000; ++i) {
+        page_id_t page_id = rng() % num_pages;
+        Page *page = bpm->FetchPage(page_id);
+        if (page == nullptr) {
+          ++errors;
+          continue;
+        }
+        if (page->GetPageId() != page_id)
+          ++errors;
+        page->WLatch();
+        ++*reinterpret_cast<int *>(page->GetData());
+        page->WUnlatch();
+        bpm->UnpinPage(page_id, true);
+      }
+    }));
+  }
+  for (auto &thread : threads)
+    thread.join();
+  EXPECT_EQ(0, errors);
+
+  int total = 0;
+  for (int i = 0; i < num_pages; ++i) {
+    Page *page = bpm->FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    total += *reinterpret_cast<int *>(page->GetData());
+    EXPECT_EQ(true, bpm->UnpinPage(i, false));
+  }
+  // no update was lost to a page read twice or written back too late
+  EXPECT_EQ(8 * 2000, total);
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
 } // namespace cmudb
@@ -0,0 +1,129 @@
+/**
+ * clock_replacer_test.cpp
+ */
+
+#include <cstdio>
+
+#include "buffer/buffer_pool_manager.h"
+#include "buffer/clock_replacer.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(ClockReplacerTest, SampleTest) {
+  ClockReplacer<int> clock_replacer(7);
+
+  // push element into replacer
+  clock_replacer.Insert(1);
+  clock_replacer.Insert(2);
+  clock_replacer.Insert(3);
+  clock_replacer.Insert(4);
+  clock_replacer.Insert(5);
+  clock_replacer.Insert(6);
+  clock_replacer.Insert(1);
+  EXPECT_EQ(6, clock_replacer.Size());
+
+  // first sweep clears every reference bit, then evicts in slot order
+  int value;
+  clock_replacer.Victim(value);
+  EXPECT_EQ(1, value);
+  clock_replacer.Victim(value);
+  EXPECT_EQ(2, value);
+  clock_replacer.Victim(value);
+  EXPECT_EQ(3, value);
+
+  // remove element from replacer
+  EXPECT_EQ(false, clock_replacer.Erase(3));
+  EXPECT_EQ(true, clock_replacer.Erase(5));
+  EXPECT_EQ(2, clock_replacer.Size());
+
+  // a referenced value gets a second chance
+  clock_replacer.Insert(4);
+  clock_replacer.Victim(value);
+  EXPECT_EQ(6, value);
+  clock_replacer.Victim(value);
+  EXPECT_EQ(4, value);
+  EXPECT_EQ(false, clock_replacer.Victim(value));
+}
+
+TEST(ClockReplacerTest, RecycleSlotTest) {
+  ClockReplacer<int> clock_replacer(2);
+  int value;
+
+  EXPECT_EQ(false, clock_replacer.Victim(value));
+
+  clock_replacer.Insert(0);
+  clock_replacer.Insert(1);
+  EXPECT_EQ(true, clock_replacer.Victim(value));
+  EXPECT_EQ(0, value);
+
+  // value 2 reuses the slot of the evicted value 0
+  clock_replacer.Insert(2);
+  EXPECT_EQ(2, clock_replacer.Size());
+  EXPECT_EQ(false, clock_replacer.Erase(0));
+
+  // more evictable values than capacity still works
+  clock_replacer.Insert(3);
+  EXPECT_EQ(3, clock_replacer.Size());
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(true, clock_replacer.Victim(value));
+  }
+  EXPECT_EQ(0, clock_replacer.Size());
+}
+
+TEST(ClockReplacerTest, BufferPoolTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm =
+      new BufferPoolManager(4, disk_manager, nullptr, 1, ReplacerType::CLOCK);
+  EXPECT_EQ(ReplacerType::CLOCK, bpm->GetReplacerType());
+
+  for (int i = 0; i < 4; ++i) {
+    auto page = bpm->NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, true));
+  }
+  // cycle more pages than frames through the pool
+  for (int i = 4; i < 12; ++i) {
+    auto page = bpm->NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, true));
+  }
+  for (int i = 0; i < 12; ++i) {
+    auto page = bpm->FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    char expected[PAGE_SIZE];
+    snprintf(expected, PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(0, strcmp(page->GetData(), expected));
+    EXPECT_EQ(true, bpm->UnpinPage(i, false));
+  }
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(ClockReplacerTest, PreferredVictimTest) {
+  ClockReplacer<int> clock_replacer(4);
+  for (int i = 1; i <= 4; ++i)
+    clock_replacer.Insert(i);
+
+  auto even = [](const int &v) { return v % 2 == 0; };
+  int value;
+  // every value still has its second chance, the regular sweep decides
+  EXPECT_EQ(true, clock_replacer.PreferredVictim(value, even));
+  EXPECT_EQ(1, value);
+  // now the even values go first
+  EXPECT_EQ(true, clock_replacer.PreferredVictim(value, even));
+  EXPECT_EQ(2, value);
+  EXPECT_EQ(true, clock_replacer.PreferredVictim(value, even));
+  EXPECT_EQ(4, value);
+  EXPECT_EQ(true, clock_replacer.PreferredVictim(value, even));
+  EXPECT_EQ(3, value);
+  EXPECT_EQ(false, clock_replacer.PreferredVictim(value, even));
+}
+
+} // namespace cmudb
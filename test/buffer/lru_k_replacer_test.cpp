@@ -0,0 +1,125 @@
+/**
+ * lru_k_replacer_test.cpp
+ */
+
+#include <cstdio>
+
+#include "buffer/buffer_pool_manager.h"
+#include "buffer/lru_k_replacer.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(LRUKReplacerTest, SampleTest) {
+  LRUKReplacer<int> lru_k_replacer(2);
+
+  // 1 and 2 are accessed twice, the others only once
+  for (int i = 1; i <= 6; ++i) {
+    lru_k_replacer.RecordAccess(i);
+  }
+  lru_k_replacer.RecordAccess(1);
+  lru_k_replacer.RecordAccess(2);
+  for (int i = 1; i <= 6; ++i) {
+    lru_k_replacer.Insert(i);
+  }
+  EXPECT_EQ(6, lru_k_replacer.Size());
+
+  // values with infinite backward distance go first, oldest first
+  int value;
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(3, value);
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(4, value);
+
+  // erase keeps the history, value 5 stays pinned
+  EXPECT_EQ(true, lru_k_replacer.Erase(5));
+  EXPECT_EQ(false, lru_k_replacer.Erase(5));
+  EXPECT_EQ(3, lru_k_replacer.Size());
+
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(6, value);
+  // 1 has the older second most recent access
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(1, value);
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(2, value);
+  EXPECT_EQ(false, lru_k_replacer.Victim(value));
+
+  // 5 was accessed once before being pinned again
+  lru_k_replacer.RecordAccess(5);
+  lru_k_replacer.Insert(5);
+  lru_k_replacer.Insert(7);
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(7, value);
+  lru_k_replacer.Remove(5);
+  EXPECT_EQ(0, lru_k_replacer.Size());
+}
+
+TEST(LRUKReplacerTest, ScanResistanceTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(
+      4, disk_manager, nullptr, 1, ReplacerType::LRU_K, 2);
+
+  // two hot pages accessed twice, their content never reaches the disk
+  // (unpinned clean), so it only survives if they are never evicted
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(temp_page_id));
+    snprintf(bpm->FetchPage(temp_page_id)->GetData(), PAGE_SIZE, "hot %d", i);
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, false));
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, false));
+  }
+  // a long scan touching every other page exactly once
+  for (int i = 2; i < 20; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(temp_page_id));
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, true));
+  }
+  for (int i = 0; i < 2; ++i) {
+    auto page = bpm->FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    char expected[PAGE_SIZE];
+    snprintf(expected, PAGE_SIZE, "hot %d", i);
+    EXPECT_EQ(0, strcmp(page->GetData(), expected));
+    EXPECT_EQ(true, bpm->UnpinPage(i, false));
+  }
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(LRUKReplacerTest, PinnedHistoryTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(
+      3, disk_manager, nullptr, 1, ReplacerType::LRU_K, 2);
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(temp_page_id));
+    snprintf(bpm->FetchPage(temp_page_id)->GetData(), PAGE_SIZE, "hot %d", i);
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, false));
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, false));
+  }
+  // page 0 is pinned by a hit, evicting page 1 must keep its history
+  ASSERT_NE(nullptr, bpm->FetchPage(0));
+  ASSERT_NE(nullptr, bpm->NewPage(temp_page_id));
+  ASSERT_NE(nullptr, bpm->NewPage(temp_page_id));
+  for (page_id_t page_id : {0, 2, 3})
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, page_id != 0));
+  // so a scan does not push it out
+  for (int i = 0; i < 5; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(temp_page_id));
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, true));
+  }
+  Page *page = bpm->FetchPage(0);
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ(0, strcmp(page->GetData(), "hot 0"));
+  EXPECT_EQ(true, bpm->UnpinPage(0, false));
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+} // namespace cmudb
@@ -97,4 +97,21 @@ TEST(LRUReplacerTest, BasicTest) {
   }
 }
 
+TEST(LRUReplacerTest, PreferredVictimTest) {
+  LRUReplacer<int> lru_replacer;
+  for (int i = 1; i <= 6; ++i) {
+    lru_replacer.Insert(i);
+  }
+
+  // only the least recently used half is searched for a preferred value
+  int value;
+  EXPECT_EQ(true, lru_replacer.PreferredVictim(
+                      value, [](const int &v) { return v % 2 == 0; }));
+  EXPECT_EQ(2, value);
+  EXPECT_EQ(true, lru_replacer.PreferredVictim(
+                      value, [](const int &v) { return v >= 5; }));
+  EXPECT_EQ(1, value);
+  EXPECT_EQ(4, lru_replacer.Size());
+}
+
 } // namespace cmudb
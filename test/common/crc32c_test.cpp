@@ -0,0 +1,79 @@
+/**
+ * crc32c_test.cpp
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "common/crc32c.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(Crc32cTest, SampleTest) {
+  // check value of the Castagnoli polynomial
+  const char digits[] = "123456789";
+  EXPECT_EQ(0xe3069283, Crc32c(digits, 9));
+  EXPECT_EQ(0xe3069283, Crc32cPortable(digits, 9));
+  EXPECT_EQ(0, Crc32c(digits, 0));
+
+  // a checksum can be continued piece by piece
+  EXPECT_EQ(0xe3069283, Crc32c(digits + 4, 5, Crc32c(digits, 4)));
+  EXPECT_EQ(0xe3069283,
+            Crc32cPortable(digits + 4, 5, Crc32cPortable(digits, 4)));
+
+  // 32 bytes of zeros, from RFC 3720
+  std::vector<char> zeros(32, 0);
+  EXPECT_EQ(0x8a9136aa, Crc32c(zeros.data(), zeros.size()));
+}
+
+TEST(Crc32cTest, PortableTest) {
+  std::mt19937 rng(0);
+  std::vector<char> data(1024);
+  for (auto &c : data)
+    c = static_cast<char>(rng());
+  // every length and alignment runs into the byte-wise tails of both versions
+  for (size_t offset = 0; offset < 8; ++offset) {
+    for (size_t size = 0; size + offset <= 100; ++size)
+      EXPECT_EQ(Crc32cPortable(data.data() + offset, size, 7),
+                Crc32c(data.data() + offset, size, 7));
+  }
+  EXPECT_EQ(Crc32cPortable(data.data(), data.size()),
+            Crc32c(data.data(), data.size()));
+}
+
+/*
+ * Checksum a few megabytes of pages with both versions
+ */
+TEST(Crc32cTest, ThroughputBenchmark) {
+  const size_t page_size = 4096, num_pages = 1024, rounds = 8;
+  std::vector<char> data(page_size * num_pages);
+  std::mt19937 rng(0);
+  for (auto &c : data)
+    c = static_cast<char>(rng());
+
+  uint32_t results[2] = {0, 0};
+  double seconds[2];
+  for (int portable = 0; portable < 2; ++portable) {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t round = 0; round < rounds; ++round) {
+      for (size_t i = 0; i < num_pages; ++i) {
+        const char *page = data.data() + i * page_size;
+        results[portable] ^= portable ? Crc32cPortable(page, page_size, i)
+                                      : Crc32c(page, page_size, i);
+      }
+    }
+    seconds[portable] = std::chrono::duration<double>(
+                            std::chrono::steady_clock::now() - start)
+                            .count();
+  }
+  double megabytes = static_cast<double>(data.size()) * rounds / (1 << 20);
+  printf("crc32c accelerated=%d MB/s=%.0f portable MB/s=%.0f\n",
+         Crc32cIsAccelerated() ? 1 : 0, megabytes / seconds[0],
+         megabytes / seconds[1]);
+  EXPECT_EQ(results[1], results[0]);
+}
+
+} // namespace cmudb
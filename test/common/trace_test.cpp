@@ -0,0 +1,83 @@
+/**
+ * trace_test.cpp
+ */
+
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/trace.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+// dump all events and return the lines written
+static std::vector<std::string> DumpLines() {
+  std::vector<std::string> lines;
+  FILE *file = tmpfile();
+  size_t count = Tracer::Dump(file);
+  rewind(file);
+  char line[256];
+  while (fgets(line, sizeof(line), file) != nullptr)
+    lines.push_back(line);
+  fclose(file);
+  EXPECT_EQ(count, lines.size());
+  return lines;
+}
+
+TEST(TraceTest, SampleTest) {
+  Tracer::Clear();
+  // the levels may be compiled out, call the function behind the macros
+  Trace(LOG_LEVEL_DEBUG, "fetch page %lld pin_count %lld", 7, 2);
+  Trace(LOG_LEVEL_TRACE, "no arguments");
+
+  auto lines = DumpLines();
+  ASSERT_EQ(2, lines.size());
+  EXPECT_NE(std::string::npos,
+            lines[0].find("DEBUG - fetch page 7 pin_count 2\n"));
+  EXPECT_NE(std::string::npos, lines[1].find("TRACE - no arguments\n"));
+}
+
+TEST(TraceTest, WrapTest) {
+  Tracer::Clear();
+  // only the newest TRACE_RING_SIZE events of a thread are kept
+  std::thread thread([]() {
+    for (int i = 0; i < TRACE_RING_SIZE + 10; ++i)
+      Trace(LOG_LEVEL_DEBUG, "event %lld", i);
+  });
+  thread.join();
+
+  auto lines = DumpLines();
+  ASSERT_EQ(TRACE_RING_SIZE, lines.size());
+  EXPECT_NE(std::string::npos, lines.front().find("event 10\n"));
+  EXPECT_NE(std::string::npos,
+            lines.back().find("event " + std::to_string(TRACE_RING_SIZE + 9)));
+}
+
+TEST(TraceTest, ConcurrentTest) {
+  Tracer::Clear();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.push_back(std::thread([t]() {
+      for (int i = 0; i < 100; ++i)
+        Trace(LOG_LEVEL_DEBUG, "thread %lld event %lld", t, i);
+    }));
+  }
+  for (auto &thread : threads)
+    thread.join();
+
+  // events of all threads are merged by time, every thread in its order
+  auto lines = DumpLines();
+  ASSERT_EQ(400, lines.size());
+  std::vector<int> next(4, 0);
+  for (auto &line : lines) {
+    int t, i;
+    auto pos = line.find("thread ");
+    ASSERT_NE(std::string::npos, pos);
+    ASSERT_EQ(2, sscanf(line.c_str() + pos, "thread %d event %d", &t, &i));
+    EXPECT_EQ(next[t]++, i);
+  }
+}
+
+} // namespace cmudb
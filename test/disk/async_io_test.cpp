@@ -0,0 +1,107 @@
+/**
+ * async_io_test.cpp
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <future>
+#include <memory>
+#include <unistd.h>
+#include <vector>
+
+#include "disk/async_io.h"
+#include "disk/disk_manager.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+// write 200 blocks in one batch, read them back in another one
+static void RoundTrip(AsyncIOEngine *engine) {
+  const size_t block_size = 512, num_blocks = 200;
+  int fd = open("async_io.db", O_RDWR | O_CREAT | O_TRUNC, 0644);
+  ASSERT_LE(0, fd);
+
+  std::vector<char> out(block_size * num_blocks);
+  std::vector<char> in(out.size() + block_size, 'x');
+  for (size_t i = 0; i < out.size(); ++i)
+    out[i] = static_cast<char>(i / block_size + i);
+  std::atomic<int> done(0), failed(0);
+  auto callback = [&](bool ok) {
+    ++done;
+    if (!ok)
+      ++failed;
+  };
+  std::vector<AsyncIORequest> requests;
+  for (size_t i = 0; i < num_blocks; ++i)
+    requests.push_back(AsyncIORequest{fd, true, out.data() + i * block_size,
+                                      block_size, i * block_size, callback});
+  engine->Submit(requests);
+  EXPECT_EQ(true, requests.empty());
+  engine->Drain();
+  EXPECT_EQ(num_blocks, done);
+
+  // the last block lies beyond the end of the file and reads as zeros
+  for (size_t i = 0; i <= num_blocks; ++i)
+    requests.push_back(AsyncIORequest{fd, false, in.data() + i * block_size,
+                                      block_size, i * block_size, callback});
+  engine->Submit(requests);
+  engine->Drain();
+  EXPECT_EQ(2 * num_blocks + 1, done);
+  EXPECT_EQ(0, failed);
+  EXPECT_EQ(0, memcmp(out.data(), in.data(), out.size()));
+  for (size_t i = out.size(); i < in.size(); ++i)
+    EXPECT_EQ(0, in[i]);
+
+  close(fd);
+  remove("async_io.db");
+}
+
+TEST(AsyncIOTest, ThreadPoolTest) {
+  // fewer slots than requests, Submit() has to wait for room
+  std::unique_ptr<AsyncIOEngine> engine(new ThreadPoolEngine(8, 3));
+  RoundTrip(engine.get());
+}
+
+TEST(AsyncIOTest, IOUringTest) {
+  std::unique_ptr<IOUringEngine> engine(new IOUringEngine(8));
+  if (!engine->IsReady()) {
+    // e.g. an old kernel or a sandbox forbidding io_uring
+    printf("io_uring not available, skipped\n");
+    return;
+  }
+  RoundTrip(engine.get());
+}
+
+TEST(AsyncIOTest, DiskManagerTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  const int num_pages = 100;
+  std::vector<std::vector<char>> pages(num_pages,
+                                       std::vector<char>(PAGE_SIZE));
+  std::vector<DiskManager::PageIO> batch;
+  for (int i = 0; i < num_pages; ++i) {
+    snprintf(pages[i].data(), PAGE_SIZE, "page %d", i);
+    batch.push_back(
+        DiskManager::PageIO{disk_manager->AllocatePage(), pages[i].data(),
+                            true, nullptr});
+  }
+  EXPECT_EQ(true, disk_manager->RunPageIO(batch));
+
+  // what was written asynchronously can be read synchronously and back
+  char data[PAGE_SIZE];
+  disk_manager->ReadPage(42, data);
+  EXPECT_EQ(0, strcmp(data, "page 42"));
+  std::future<bool> written = disk_manager->WritePageAsync(7, pages[8].data());
+  EXPECT_EQ(true, written.get());
+  std::future<bool> read = disk_manager->ReadPageAsync(7, data);
+  EXPECT_EQ(true, read.get());
+  EXPECT_EQ(0, strcmp(data, "page 8"));
+  disk_manager->WaitForPageIO();
+
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+} // namespace cmudb
@@ -0,0 +1,262 @@
+/**
+ * disk_manager_test.cpp
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <set>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "common/exception.h"
+#include "disk/disk_manager.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(DiskManagerTest, FreeListTest) {
+  remove("test.db");
+  DiskManager *disk_manager = new DiskManager("test.db");
+  // 512 byte pages hold 125 page ids per trunk, 300 pages need several
+  const int num_pages = 400, num_freed = 300;
+  for (int i = 0; i < num_pages; ++i)
+    EXPECT_EQ(i, disk_manager->AllocatePage());
+  for (int i = 0; i < num_freed; ++i)
+    disk_manager->DeallocatePage(i);
+  EXPECT_EQ(num_freed, disk_manager->GetNumFreePages());
+  delete disk_manager;
+
+  // the free list and the next page id survive reopening
+  disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(num_freed, disk_manager->GetNumFreePages());
+  std::set<page_id_t> reused;
+  for (int i = 0; i < num_freed; ++i) {
+    page_id_t page_id = disk_manager->AllocatePage();
+    EXPECT_GT(num_freed, page_id);
+    reused.insert(page_id);
+  }
+  EXPECT_EQ(num_freed, reused.size());
+  EXPECT_EQ(0, disk_manager->GetNumFreePages());
+  EXPECT_EQ(num_pages, disk_manager->AllocatePage());
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(DiskManagerTest, FreeListCrashTest) {
+  remove("test.db");
+  remove("crash.db");
+  DiskManager *disk_manager = new DiskManager("test.db");
+  const int num_pages = 400, num_freed = 300;
+  for (int i = 0; i < num_pages; ++i)
+    disk_manager->AllocatePage();
+  for (int i = 0; i < num_freed; ++i)
+    disk_manager->DeallocatePage(i);
+  // copy the file while the disk manager is still open, as a crash would
+  // leave it: the destructor never gets to write the meta block
+  {
+    std::ifstream source("test.db", std::ios::binary);
+    std::ofstream target("crash.db", std::ios::binary);
+    target << source.rdbuf();
+  }
+  delete disk_manager;
+
+  // the free list is complete and only lists deallocated pages
+  disk_manager = new DiskManager("crash.db");
+  EXPECT_EQ(num_freed, disk_manager->GetNumFreePages());
+  std::set<page_id_t> reused;
+  for (int i = 0; i < num_freed; ++i) {
+    page_id_t page_id = disk_manager->AllocatePage();
+    EXPECT_GT(num_freed, page_id);
+    reused.insert(page_id);
+  }
+  EXPECT_EQ(num_freed, reused.size());
+  EXPECT_EQ(0, disk_manager->GetNumFreePages());
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+  remove("crash.db");
+  remove("crash.log");
+}
+
+TEST(DiskManagerTest, ExtentTest) {
+  remove("test.db");
+  DiskManager *disk_manager = new DiskManager("test.db");
+  // two chains growing in turns, each one gets its own extents
+  page_id_t last[2] = {disk_manager->AllocatePage(),
+                       disk_manager->AllocatePage()};
+  EXPECT_EQ(0, last[0]);
+  EXPECT_EQ(1, last[1]);
+  const int chain_size = EXTENT_SIZE + 10;
+  for (int i = 0; i < chain_size; ++i) {
+    for (int owner = 0; owner < 2; ++owner) {
+      page_id_t page_id = disk_manager->AllocatePage(last[owner]);
+      if (i == 0) {
+        EXPECT_EQ(2 + owner * EXTENT_SIZE, page_id);
+      } else if (i == EXTENT_SIZE) {
+        EXPECT_EQ(2 + (2 + owner) * EXTENT_SIZE, page_id);
+      } else {
+        EXPECT_EQ(last[owner] + 1, page_id);
+      }
+      last[owner] = page_id;
+    }
+  }
+  char data[PAGE_SIZE];
+  memset(data, 0, PAGE_SIZE);
+  disk_manager->WritePage(last[1], data);
+  // the unused pages of the last extent go back to the end of the file,
+  // those of the one before go to the free list
+  delete disk_manager;
+
+  disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(EXTENT_SIZE - 10, disk_manager->GetNumFreePages());
+  EXPECT_EQ(2 + 3 * EXTENT_SIZE + 10, disk_manager->GetNumPages());
+  delete disk_manager;
+  // nothing was ever written past the last allocated page, the meta block
+  // comes first
+  struct stat stat_buf;
+  ASSERT_EQ(0, stat("test.db", &stat_buf));
+  EXPECT_EQ((1 + 2 + 3 * EXTENT_SIZE + 10) * PAGE_SIZE, stat_buf.st_size);
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(DiskManagerTest, DeletePageTest) {
+  remove("test.db");
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(4, disk_manager);
+  page_id_t page_id;
+  for (int i = 0; i < 8; ++i) {
+    Page *page = bpm->NewPage(page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, true));
+  }
+  bpm->FlushAllPages();
+
+  // a deleted page comes back empty as the next new page, the file does not
+  // grow
+  ASSERT_NE(nullptr, bpm->FetchPage(5));
+  EXPECT_EQ(true, bpm->UnpinPage(5, false));
+  EXPECT_EQ(true, bpm->DeletePage(5));
+  Page *page = bpm->NewPage(page_id);
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ(5, page_id);
+  EXPECT_EQ(0, page->GetData()[0]);
+  EXPECT_EQ(true, bpm->UnpinPage(page_id, true));
+  EXPECT_EQ(8, disk_manager->GetNumPages());
+
+  // the other pages are untouched
+  for (int i = 0; i < 8; ++i) {
+    if (i == 5)
+      continue;
+    char expected[16];
+    snprintf(expected, sizeof(expected), "page %d", i);
+    page = bpm->FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(0, strcmp(page->GetData(), expected));
+    EXPECT_EQ(true, bpm->UnpinPage(i, false));
+  }
+
+  // page 0 was evicted, deleting it frees it on disk all the same
+  EXPECT_EQ(true, bpm->DeletePage(0));
+  EXPECT_EQ(1, disk_manager->GetNumFreePages());
+  ASSERT_NE(nullptr, bpm->NewPage(page_id));
+  EXPECT_EQ(0, page_id);
+  EXPECT_EQ(true, bpm->UnpinPage(page_id, false));
+  EXPECT_EQ(8, disk_manager->GetNumPages());
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(DiskManagerTest, ChecksumTest) {
+  remove("test.db");
+  DiskManager *disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(PAGE_SIZE - CHECKSUM_SIZE, disk_manager->GetUsablePageSize());
+  char data[PAGE_SIZE];
+  for (int i = 0; i < 4; ++i) {
+    page_id_t page_id = disk_manager->AllocatePage();
+    memset(data, 'a' + i, PAGE_SIZE);
+    disk_manager->WritePage(page_id, data);
+  }
+  // a page allocated but never written passes as well
+  page_id_t unwritten = disk_manager->AllocatePage();
+  EXPECT_EQ(true, disk_manager->ReadPage(unwritten, data));
+  EXPECT_EQ(true, disk_manager->ReadPage(2, data));
+  EXPECT_EQ('c', data[0]);
+  EXPECT_EQ(0, disk_manager->GetNumChecksumFailures());
+  delete disk_manager;
+
+  // flip one byte of page 2 behind the back of the disk manager, the meta
+  // block occupies the first page of the file
+  int fd = open("test.db", O_RDWR);
+  ASSERT_LE(0, fd);
+  char byte = 'x';
+  EXPECT_EQ(1, pwrite(fd, &byte, 1, 3 * PAGE_SIZE + 100));
+  close(fd);
+
+  disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(false, disk_manager->ReadPage(2, data));
+  EXPECT_EQ(1, disk_manager->GetNumChecksumFailures());
+  char *pages[4];
+  std::vector<char> run(4 * PAGE_SIZE);
+  bool intact[4];
+  for (int i = 0; i < 4; ++i)
+    pages[i] = run.data() + i * PAGE_SIZE;
+  EXPECT_EQ(false, disk_manager->ReadPages(0, pages, 4, intact));
+  EXPECT_EQ(true, intact[0]);
+  EXPECT_EQ(true, intact[1]);
+  EXPECT_EQ(false, intact[2]);
+  EXPECT_EQ(true, intact[3]);
+  EXPECT_EQ(false, disk_manager->ReadPageAsync(2, data).get());
+
+  // the buffer pool does not hand out the corrupt page
+  BufferPoolManager *bpm = new BufferPoolManager(4, disk_manager);
+  EXPECT_EQ(nullptr, bpm->FetchPage(2));
+  EXPECT_EQ(1, bpm->GetStats().checksum_failures_);
+  Page *page = bpm->FetchPage(3);
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ('d', page->GetData()[0]);
+  EXPECT_EQ(true, bpm->UnpinPage(3, false));
+
+  // writing the page again repairs it
+  memset(data, 'c', PAGE_SIZE);
+  disk_manager->WritePage(2, data);
+  page = bpm->FetchPage(2);
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ('c', page->GetData()[0]);
+  EXPECT_EQ(true, bpm->UnpinPage(2, false));
+  delete bpm;
+  delete disk_manager;
+
+  // zeros where a page was written mean it was lost, pages beyond the end
+  // of the file were never written
+  fd = open("test.db", O_RDWR);
+  ASSERT_LE(0, fd);
+  std::vector<char> zeros(PAGE_SIZE, 0);
+  EXPECT_EQ(PAGE_SIZE, pwrite(fd, zeros.data(), PAGE_SIZE, 4 * PAGE_SIZE));
+  close(fd);
+  disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(false, disk_manager->ReadPage(3, data));
+  EXPECT_EQ(false, disk_manager->VerifyPage(3, zeros.data()));
+  EXPECT_EQ(true, disk_manager->VerifyPage(100, zeros.data()));
+  EXPECT_EQ(true, disk_manager->ReadPage(disk_manager->AllocatePage(), data));
+  delete disk_manager;
+
+  // a damaged meta block is rejected
+  fd = open("test.db", O_RDWR);
+  ASSERT_LE(0, fd);
+  EXPECT_EQ(1, pwrite(fd, &byte, 1, 100));
+  close(fd);
+  EXPECT_THROW(DiskManager("test.db"), Exception);
+  remove("test.db");
+  remove("test.log");
+}
+
+} // namespace cmudb
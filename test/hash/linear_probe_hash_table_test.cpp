@@ -0,0 +1,132 @@
+/**
+ * linear_probe_hash_table_test.cpp
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "hash/linear_probe_hash_table.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(LinearProbeHashTableTest, SampleTest) {
+  LinearProbeHashTable<int, int> *test = new LinearProbeHashTable<int, int>(5);
+  // twice the entries allowed, rounded up to a power of two
+  EXPECT_EQ(5, test->GetCapacity());
+  EXPECT_EQ(16, test->GetNumSlots());
+
+  for (int i = 1; i <= 5; ++i)
+    test->Insert(i, i * 10);
+  EXPECT_EQ(5, test->Size());
+
+  int result = 0;
+  for (int i = 1; i <= 5; ++i) {
+    EXPECT_EQ(true, test->Find(i, result));
+    EXPECT_EQ(i * 10, result);
+  }
+  EXPECT_EQ(false, test->Find(6, result));
+
+  // overwrite
+  test->Insert(3, 33);
+  EXPECT_EQ(true, test->Find(3, result));
+  EXPECT_EQ(33, result);
+  EXPECT_EQ(5, test->Size());
+
+  // delete
+  EXPECT_EQ(true, test->Remove(3));
+  EXPECT_EQ(false, test->Remove(3));
+  EXPECT_EQ(false, test->Find(3, result));
+  EXPECT_EQ(4, test->Size());
+  for (int i : {1, 2, 4, 5}) {
+    EXPECT_EQ(true, test->Find(i, result));
+    EXPECT_EQ(i * 10, result);
+  }
+
+  delete test;
+}
+
+TEST(LinearProbeHashTableTest, ChurnTest) {
+  // same pattern as a buffer pool: a bounded working set over growing keys
+  LinearProbeHashTable<int, int> *test = new LinearProbeHashTable<int, int>(8);
+  for (int i = 0; i < 10000; ++i) {
+    if (i >= 8) {
+      EXPECT_EQ(true, test->Remove(i - 8));
+    }
+    test->Insert(i, i);
+  }
+  EXPECT_EQ(8, test->Size());
+  int result = 0;
+  for (int i = 0; i < 10000; ++i)
+    EXPECT_EQ(i >= 10000 - 8, test->Find(i, result));
+  delete test;
+}
+
+TEST(LinearProbeHashTableTest, ShiftTest) {
+  // a full table, every key but the first one lands in a cluster
+  LinearProbeHashTable<int, int> *test =
+      new LinearProbeHashTable<int, int>(100);
+  std::vector<int> keys(100);
+  for (int i = 0; i < 100; ++i) {
+    keys[i] = i;
+    test->Insert(i, -i);
+  }
+  // removals shift the entries behind them back, none may get lost
+  std::mt19937 rng(0);
+  std::shuffle(keys.begin(), keys.end(), rng);
+  int result = 0;
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(true, test->Remove(keys[i]));
+    EXPECT_EQ(false, test->Find(keys[i], result));
+    for (int j = i + 1; j < 100; ++j) {
+      EXPECT_EQ(true, test->Find(keys[j], result));
+      EXPECT_EQ(-keys[j], result);
+    }
+  }
+  EXPECT_EQ(0, test->Size());
+  delete test;
+}
+
+TEST(LinearProbeHashTableTest, ConcurrentTest) {
+  LinearProbeHashTable<int, int> *test =
+      new LinearProbeHashTable<int, int>(64);
+  // keys below 32 are never removed, so readers must always find them
+  for (int i = 0; i < 32; ++i)
+    test->Insert(i, i * 2);
+
+  std::atomic<bool> stop(false);
+  std::atomic<int> errors(0);
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; ++t) {
+    readers.push_back(std::thread([&]() {
+      int result;
+      while (!stop) {
+        for (int i = 0; i < 64; ++i) {
+          bool found = test->Find(i, result);
+          if ((i < 32 && !found) || (found && result != i * 2))
+            ++errors;
+        }
+      }
+    }));
+  }
+  std::thread writer([&]() {
+    for (int round = 0; round < 2000; ++round) {
+      for (int i = 32; i < 64; ++i)
+        test->Insert(i, i * 2);
+      for (int i = 32; i < 64; ++i)
+        test->Remove(i);
+    }
+    stop = true;
+  });
+  writer.join();
+  for (auto &reader : readers)
+    reader.join();
+  EXPECT_EQ(0, errors);
+  EXPECT_EQ(32, test->Size());
+  delete test;
+}
+
+} // namespace cmudb
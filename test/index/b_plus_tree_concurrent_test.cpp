@@ -3,6 +3,7 @@
  */
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cstdio>
 #include <functional>
@@ -202,8 +203,8 @@ TEST(BPlusTreeConcurrentTest, InsertTest1) {
   bpm->UnpinPage(HEADER_PAGE_ID, true);
 //  EXPECT_TRUE(tree.Check(true));
   delete key_schema;
-  delete disk_manager;
   delete bpm;
+  delete disk_manager;
   delete transaction;
   remove("test.db");
   remove("test.log");
@@ -259,8 +260,8 @@ TEST(BPlusTreeConcurrentTest, InsertTest2) {
   bpm->UnpinPage(HEADER_PAGE_ID, true);
 //  EXPECT_TRUE(tree.Check(true));
   delete key_schema;
-  delete disk_manager;
   delete bpm;
+  delete disk_manager;
   delete transaction;
   remove("test.db");
   remove("test.log");
@@ -319,8 +320,72 @@ TEST(BPlusTreeConcurrentTest, InsertAndGetTest) {
   bpm->UnpinPage(HEADER_PAGE_ID, true);
 //  EXPECT_TRUE(tree.Check(true));
   delete key_schema;
+  delete bpm;
   delete disk_manager;
+  delete transaction;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeConcurrentTest, OptimisticGetTest) {
+  // create KeyComparator and index schema
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<16> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  // create b+ tree
+  BPlusTree<GenericKey<16>, RID, GenericComparator<16>> tree("foo_pk", bpm,
+                                                             comparator);
+  // create and fetch header_page
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(page_id);
+  (void)header_page;
+  // even keys are there from the start, odd keys are inserted while reading
+  std::vector<int64_t> keys, late_keys;
+  int64_t scale_factor = 1000;
+  for (int64_t key = 1; key < scale_factor; key++) {
+    if (key % 2 == 0)
+      keys.push_back(key);
+    else
+      late_keys.push_back(key);
+  }
+  InsertHelper(tree, keys);
+
+  std::atomic<bool> done(false);
+  std::thread writer([&]() {
+    InsertHelper(tree, late_keys);
+    done = true;
+  });
+  // readers walk down the splitting tree without latches
+  LaunchParallelTest(4, [&](uint64_t) {
+    Transaction *transaction = new Transaction(0);
+    GenericKey<16> index_key;
+    do {
+      for (auto key : keys) {
+        std::vector<RID> rids;
+        index_key.SetFromInteger(key);
+        EXPECT_EQ(true, tree.GetValue(index_key, rids, transaction));
+        EXPECT_EQ(key, rids[0].GetSlotNum());
+      }
+    } while (!done);
+    delete transaction;
+  });
+  writer.join();
+
+  Transaction *transaction = new Transaction(0);
+  GenericKey<16> index_key;
+  for (int64_t key = 1; key < scale_factor; key++) {
+    std::vector<RID> rids;
+    index_key.SetFromInteger(key);
+    EXPECT_EQ(true, tree.GetValue(index_key, rids, transaction));
+    EXPECT_EQ(key, rids[0].GetSlotNum());
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete key_schema;
   delete bpm;
+  delete disk_manager;
   delete transaction;
   remove("test.db");
   remove("test.log");
@@ -367,8 +432,8 @@ TEST(BPlusTreeConcurrentTest, DeleteTest1) {
   bpm->UnpinPage(HEADER_PAGE_ID, true);
 //  EXPECT_TRUE(tree.Check(true));
   delete key_schema;
-  delete disk_manager;
   delete bpm;
+  delete disk_manager;
   remove("test.db");
   remove("test.log");
 }
@@ -413,8 +478,8 @@ TEST(BPlusTreeConcurrentTest, DeleteAndGetTest) {
   bpm->UnpinPage(HEADER_PAGE_ID, true);
 //  EXPECT_TRUE(tree.Check(true));
   delete key_schema;
-  delete disk_manager;
   delete bpm;
+  delete disk_manager;
   remove("test.db");
   remove("test.log");
 }
@@ -460,8 +525,8 @@ TEST(BPlusTreeConcurrentTest, DeleteTest2) {
   bpm->UnpinPage(HEADER_PAGE_ID, true);
 //  EXPECT_TRUE(tree.Check(true));
   delete key_schema;
-  delete disk_manager;
   delete bpm;
+  delete disk_manager;
   remove("test.db");
   remove("test.log");
 }
@@ -510,8 +575,8 @@ TEST(BPlusTreeConcurrentTest, DeleteTest3) {
 //  EXPECT_TRUE(tree.Check(true));
   bpm->UnpinPage(HEADER_PAGE_ID, true);
   delete key_schema;
-  delete disk_manager;
   delete bpm;
+  delete disk_manager;
   remove("test.db");
 }
 
@@ -561,8 +626,8 @@ TEST(BPlusTreeConcurrentTest, DeleteTest4) {
 //  EXPECT_TRUE(tree.Check(true));
   bpm->UnpinPage(HEADER_PAGE_ID, true);
   delete key_schema;
-  delete disk_manager;
   delete bpm;
+  delete disk_manager;
   remove("test.db");
 }
 
@@ -664,8 +729,8 @@ TEST(BPlusTreeConcurrentTest, MixTest) {
   bpm->UnpinPage(HEADER_PAGE_ID, true);
 //  EXPECT_TRUE(tree.Check(true));
   delete key_schema;
-  delete disk_manager;
   delete bpm;
+  delete disk_manager;
   remove("test.db");
   remove("test.log");
 }
@@ -730,8 +795,8 @@ TEST(BPlusTreeConcurrentTest, MixTest2) {
 //  EXPECT_TRUE(tree.Check(true));
   bpm->UnpinPage(HEADER_PAGE_ID, true);
   delete key_schema;
-  delete disk_manager;
   delete bpm;
+  delete disk_manager;
   delete transaction;
   remove("test.db");
   remove("test.log");
@@ -827,8 +892,8 @@ TEST(BPlusTreeConcurrentTest, MixTest3) {
 //  EXPECT_TRUE(tree.Check(true));
   bpm->UnpinPage(HEADER_PAGE_ID, true);
   delete key_schema;
-  delete disk_manager;
   delete bpm;
+  delete disk_manager;
   delete transaction;
   remove("test.db");
   remove("test.log");
@@ -61,4 +61,50 @@ TEST(TupleTest, TableHeapTest) {
   delete disk_manager;
 }
 
+TEST(TupleTest, MappedTableHeapTest) {
+  std::string createStmt = "a bigint, b varchar(16)";
+  Schema *schema = ParseCreateStatement(createStmt);
+  Tuple tuple = ConstructTuple(schema);
+
+  Transaction *transaction = new Transaction(0);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *buffer_pool_manager =
+      new BufferPoolManager(10, disk_manager);
+  LockManager *lock_manager = new LockManager(true);
+  LogManager *log_manager = new LogManager(disk_manager);
+  TableHeap *table = new TableHeap(buffer_pool_manager, lock_manager,
+                                   log_manager, transaction);
+  page_id_t first_page_id = table->GetFirstPageId();
+  RID rid;
+  for (int i = 0; i < 500; ++i)
+    table->InsertTuple(tuple, rid, transaction);
+  buffer_pool_manager->FlushAllPages();
+  delete table;
+  delete buffer_pool_manager;
+  delete disk_manager;
+
+  // the same table served read-only from the mapped file
+  disk_manager = new DiskManager("test.db", PAGE_SIZE, true);
+  buffer_pool_manager = new BufferPoolManager(10, disk_manager);
+  table = new TableHeap(buffer_pool_manager, lock_manager, log_manager,
+                        first_page_id);
+  int count = 0;
+  for (auto itr = table->begin(transaction); itr != table->end(); ++itr) {
+    EXPECT_EQ(tuple.ToString(schema), itr->ToString(schema));
+    ++count;
+  }
+  EXPECT_EQ(500, count);
+  EXPECT_EQ(0, buffer_pool_manager->GetStats().pinned_frames_);
+
+  remove("test.db");
+  remove("test.log");
+  delete schema;
+  delete table;
+  delete buffer_pool_manager;
+  delete disk_manager;
+  delete lock_manager;
+  delete log_manager;
+  delete transaction;
+}
+
 } // namespace cmudb